@@ -0,0 +1,130 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef _WIN32
+
+#  include <ccache/context.hpp>
+#  include <ccache/execute.hpp>
+#  include <ccache/util/environment.hpp>
+#  include <ccache/util/exec.hpp>
+#  include <ccache/util/fd.hpp>
+#  include <ccache/util/path.hpp>
+
+#  include <benchmark/benchmark.h>
+
+#  include <fcntl.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+
+#  include <cstdint>
+#  include <string>
+#  include <vector>
+
+namespace {
+
+// Memory touched by the benchmarking process to simulate ccache having read
+// large manifests before spawning the compiler. Spawning with fork(2) gets
+// slower the more memory the parent has mapped.
+class ResidentMemory
+{
+public:
+  explicit ResidentMemory(int64_t mebibytes)
+    : m_data(static_cast<size_t>(mebibytes) * 1024 * 1024)
+  {
+    for (size_t i = 0; i < m_data.size(); i += 4096) {
+      m_data[i] = 1;
+    }
+    benchmark::DoNotOptimize(m_data.data());
+  }
+
+private:
+  std::vector<uint8_t> m_data;
+};
+
+std::string
+find_true()
+{
+  return util::pstr(
+           find_executable_in_path("true", util::getenv_path_list("PATH")))
+    .str();
+}
+
+util::Fd
+open_dev_null()
+{
+  return util::Fd(open(util::get_dev_null_path(), O_WRONLY));
+}
+
+} // namespace
+
+// The path used for running the compiler and preprocessor.
+static void
+BM_execute(benchmark::State& state)
+{
+  ResidentMemory memory(state.range(0));
+  Context ctx;
+  const auto true_path = find_true();
+  const char* const argv[] = {true_path.c_str(), nullptr};
+
+  for (auto _ : state) {
+    const int status = execute(ctx, argv, open_dev_null(), open_dev_null());
+    benchmark::DoNotOptimize(status);
+  }
+}
+
+BENCHMARK(BM_execute)->Arg(0)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+// The path used for compiler_check commands.
+static void
+BM_exec_to_string(benchmark::State& state)
+{
+  ResidentMemory memory(state.range(0));
+  const util::Args args{find_true()};
+
+  for (auto _ : state) {
+    auto output = util::exec_to_string(args);
+    benchmark::DoNotOptimize(output);
+  }
+}
+
+BENCHMARK(BM_exec_to_string)->Arg(0)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+// Reference: plain fork(2) + execv(3), which copies the page tables of the
+// parent.
+static void
+BM_fork_exec(benchmark::State& state)
+{
+  ResidentMemory memory(state.range(0));
+  const auto true_path = find_true();
+  const char* const argv[] = {true_path.c_str(), nullptr};
+
+  for (auto _ : state) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      execv(argv[0], const_cast<char* const*>(argv));
+      _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    benchmark::DoNotOptimize(status);
+  }
+}
+
+BENCHMARK(BM_fork_exec)->Arg(0)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+#endif
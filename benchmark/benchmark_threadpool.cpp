@@ -0,0 +1,151 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <ccache/util/threadpool.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace {
+
+// Number of tasks per benchmark iteration.
+const size_t k_tasks = 10'000;
+
+// Simulate a short task like hashing a small file or stat-ing a cache file.
+void
+short_task(std::atomic<uint64_t>& sink)
+{
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < 100; ++i) {
+    benchmark::DoNotOptimize(value += i);
+  }
+  sink.fetch_add(value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+// Many short tasks submitted one at a time from outside the pool.
+static void
+BM_enqueue_detach(benchmark::State& state)
+{
+  const auto threads = static_cast<size_t>(state.range(0));
+  std::atomic<uint64_t> sink = 0;
+
+  for (auto _ : state) {
+    util::ThreadPool pool(threads);
+    for (size_t i = 0; i < k_tasks; ++i) {
+      pool.enqueue_detach([&] { short_task(sink); });
+    }
+    pool.shut_down();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * k_tasks));
+}
+
+BENCHMARK(BM_enqueue_detach)
+  ->Arg(1)
+  ->Arg(4)
+  ->Arg(16)
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// The same tasks submitted as one batch.
+static void
+BM_enqueue_detach_batch(benchmark::State& state)
+{
+  const auto threads = static_cast<size_t>(state.range(0));
+  std::atomic<uint64_t> sink = 0;
+
+  for (auto _ : state) {
+    util::ThreadPool pool(threads);
+    std::vector<std::function<void()>> tasks(k_tasks,
+                                             [&] { short_task(sink); });
+    pool.enqueue_detach(std::move(tasks));
+    pool.shut_down();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * k_tasks));
+}
+
+BENCHMARK(BM_enqueue_detach_batch)
+  ->Arg(1)
+  ->Arg(4)
+  ->Arg(16)
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// Tasks that spawn subtasks, which end up in the spawning worker's own queue
+// and have to be stolen by the other workers.
+static void
+BM_nested_enqueue(benchmark::State& state)
+{
+  const auto threads = static_cast<size_t>(state.range(0));
+  const size_t k_outer_tasks = 100;
+  std::atomic<uint64_t> sink = 0;
+
+  for (auto _ : state) {
+    util::ThreadPool pool(threads);
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < k_outer_tasks; ++i) {
+      futures.push_back(pool.enqueue([&] {
+        for (size_t j = 0; j < k_tasks / k_outer_tasks; ++j) {
+          pool.enqueue_detach([&] { short_task(sink); });
+        }
+      }));
+    }
+    // Tasks enqueued after shut_down are dropped.
+    for (auto& future : futures) {
+      future.get();
+    }
+    pool.shut_down();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * k_tasks));
+}
+
+BENCHMARK(BM_nested_enqueue)
+  ->Arg(1)
+  ->Arg(4)
+  ->Arg(16)
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+static void
+BM_parallel_for(benchmark::State& state)
+{
+  const auto threads = static_cast<size_t>(state.range(0));
+  const auto chunk_size = static_cast<size_t>(state.range(1));
+  std::atomic<uint64_t> sink = 0;
+  util::ThreadPool pool(threads);
+
+  for (auto _ : state) {
+    pool.parallel_for(
+      0, k_tasks, [&](size_t /*index*/) { short_task(sink); }, chunk_size);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * k_tasks));
+}
+
+BENCHMARK(BM_parallel_for)
+  ->Args({4, 1})
+  ->Args({4, 64})
+  ->Args({16, 1})
+  ->Args({16, 64})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
@@ -0,0 +1,345 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "buildsession.hpp"
+
+#include <ccache/config.hpp>
+#include <ccache/util/conversion.hpp>
+#include <ccache/util/defer.hpp>
+#include <ccache/util/direntry.hpp>
+#include <ccache/util/fd.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/filesystem.hpp>
+#include <ccache/util/format.hpp>
+#include <ccache/util/logging.hpp>
+#include <ccache/util/path.hpp>
+#include <ccache/util/temporaryfile.hpp>
+
+#include <fcntl.h>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace fs = util::filesystem;
+
+using namespace std::chrono_literals;
+
+// The session table is an open addressing hash table with linear probing.
+// Entries are never modified after they have been published, so readers only
+// need to check the state of an entry before reading it. An entry whose writer
+// died before publishing it is skipped forever, which is harmless since the
+// table is discarded at the end of the session.
+
+namespace {
+
+// Increment if the format of the shared region changes.
+const uint32_t k_version = 1;
+
+// Note: Increment the version number if constants affecting storage size are
+// changed.
+const uint32_t k_num_entries = 64 * 1024;
+
+// Maximum number of entries to examine before giving up on a lookup or insert.
+const uint32_t k_max_probes = 64;
+
+enum class EntryState : uint32_t { empty = 0, writing = 1, ready = 2 };
+
+} // namespace
+
+struct BuildSession::Entry
+{
+  std::atomic<EntryState> state;
+  int32_t return_value;     // Cached return value
+  Hash::Digest key_digest;  // Hash of content type and path
+  Hash::Digest file_digest; // Cached file hash
+  uint64_t device;
+  uint64_t inode;
+  uint64_t size;
+  int64_t mtime;
+  int64_t ctime;
+};
+
+struct BuildSession::SharedRegion
+{
+  uint32_t version;
+  Entry entries[k_num_entries];
+};
+
+static_assert(std::is_trivially_copyable_v<Hash::Digest>,
+              "Digest is expected to be trivially copyable.");
+static_assert(std::atomic<EntryState>::is_always_lock_free,
+              "Entry state must be lock-free to be shared between processes.");
+
+namespace {
+
+Hash::Digest
+key_digest_for(const fs::path& path, InodeCache::ContentType type)
+{
+  Hash hash;
+  hash.hash(static_cast<int64_t>(type));
+  hash.hash(path);
+  return hash.digest();
+}
+
+uint32_t
+first_index(const Hash::Digest& key_digest)
+{
+  uint32_t hash;
+  util::big_endian_to_int(key_digest.data(), hash);
+  return hash % k_num_entries;
+}
+
+template<typename T>
+bool
+entry_matches(const T& entry, const util::DirEntry& de)
+{
+  return entry.device == static_cast<uint64_t>(de.device())
+         && entry.inode == static_cast<uint64_t>(de.inode())
+         && entry.size == de.size() && entry.mtime == util::nsec_tot(de.mtime())
+         && entry.ctime == util::nsec_tot(de.ctime());
+}
+
+} // namespace
+
+BuildSession::BuildSession(const Config& config,
+                           std::chrono::nanoseconds min_age)
+  : m_config(config),
+    // CCACHE_DISABLE_INODE_CACHE_MIN_AGE is only for testing purposes; see
+    // test/suites/inode_cache.bash.
+    m_min_age(getenv("CCACHE_DISABLE_INODE_CACHE_MIN_AGE") ? 0ns : min_age)
+{
+}
+
+tl::expected<void, std::string>
+BuildSession::begin(const Config& config)
+{
+  const auto path = get_path(config);
+  if (BuildSession(config).initialize()) {
+    LOG("Build session {} is already active", path);
+    return {};
+  }
+
+  // Create the new file to a temporary name to prevent other processes from
+  // mapping it before it is fully initialized.
+  auto tmp_file = util::TemporaryFile::create(path);
+  if (!tmp_file) {
+    return tl::unexpected(
+      FMT("Failed to create build session file: {}", tmp_file.error()));
+  }
+  DEFER(unlink(util::pstr(tmp_file->path).c_str()));
+
+  if (!InodeCache::available(*tmp_file->fd)) {
+    return tl::unexpected(
+      FMT("The file system of {} does not support build sessions",
+          path.parent_path()));
+  }
+  if (auto result = util::fallocate(*tmp_file->fd, sizeof(SharedRegion));
+      !result) {
+    return tl::unexpected(FMT(
+      "Failed to allocate file space for build session: {}", result.error()));
+  }
+  auto map = util::MemoryMap::map(*tmp_file->fd, sizeof(SharedRegion));
+  if (!map) {
+    return tl::unexpected(
+      FMT("Failed to map build session file: {}", map.error()));
+  }
+  auto sr = reinterpret_cast<SharedRegion*>(map->ptr());
+  sr->version = k_version;
+  for (auto& entry : sr->entries) {
+    entry.state = EntryState::empty;
+  }
+  map->unmap();
+  tmp_file->fd.close();
+
+#ifndef _WIN32
+  // Like for the inode cache, linking fails if another process won a race to
+  // create the session, and then that session is used.
+  if (auto result = fs::create_hard_link(tmp_file->path, path); !result) {
+    if (result.error() != std::errc::file_exists) {
+      return tl::unexpected(FMT("Failed to link build session file: {}",
+                                result.error().message()));
+    }
+  }
+#else
+  if (auto result = fs::rename(tmp_file->path, path); !result) {
+    return tl::unexpected(FMT("Failed to rename build session file: {}",
+                              result.error().message()));
+  }
+#endif
+
+  LOG("Started build session {}", path);
+  return {};
+}
+
+tl::expected<bool, std::string>
+BuildSession::end(const Config& config)
+{
+  const auto path = get_path(config);
+  const auto result = util::remove(path, util::LogFailure::no);
+  if (!result) {
+    return tl::unexpected(FMT(
+      "Failed to remove build session file: {}", result.error().message()));
+  }
+  if (*result) {
+    LOG("Ended build session {}", path);
+  }
+  return *result;
+}
+
+fs::path
+BuildSession::get_path(const Config& config)
+{
+  const uint8_t arch_bits = 8 * sizeof(void*);
+  return config.temporary_dir()
+         / FMT("build-session-{}.v{}", arch_bits, k_version);
+}
+
+std::optional<std::pair<SourceCodeScanResult, Hash::Digest>>
+BuildSession::get(const fs::path& path, InodeCache::ContentType type)
+{
+  if (!initialize()) {
+    return std::nullopt;
+  }
+
+  util::DirEntry de(path);
+  if (!de.is_regular_file()) {
+    return std::nullopt;
+  }
+
+  const auto key_digest = key_digest_for(path, type);
+  const uint32_t start = first_index(key_digest);
+  for (uint32_t i = 0; i < k_max_probes; ++i) {
+    const Entry& entry = m_sr->entries[(start + i) % k_num_entries];
+    const auto state = entry.state.load(std::memory_order_acquire);
+    if (state == EntryState::empty) {
+      break;
+    }
+    if (state == EntryState::ready && entry.key_digest == key_digest
+        && entry_matches(entry, de)) {
+      if (m_config.debug()) {
+        LOG("Build session hit: {}", path);
+      }
+      return std::make_pair(
+        SourceCodeScanResult::from_bitmask(entry.return_value),
+        entry.file_digest);
+    }
+  }
+
+  if (m_config.debug()) {
+    LOG("Build session miss: {}", path);
+  }
+  return std::nullopt;
+}
+
+bool
+BuildSession::put(const fs::path& path,
+                  InodeCache::ContentType type,
+                  const Hash::Digest& file_digest,
+                  SourceCodeScanResult return_value)
+{
+  if (!initialize()) {
+    return false;
+  }
+
+  util::DirEntry de(path);
+  if (!de.is_regular_file()) {
+    return false;
+  }
+
+  // See comment for InodeCache::InodeCache why this check is done.
+  const auto now = util::now();
+  if (now - de.ctime() < m_min_age || now - de.mtime() < m_min_age) {
+    LOG("Too new ctime or mtime of {}, not adding to build session", path);
+    return false;
+  }
+
+  const auto key_digest = key_digest_for(path, type);
+  const uint32_t start = first_index(key_digest);
+  for (uint32_t i = 0; i < k_max_probes; ++i) {
+    Entry& entry = m_sr->entries[(start + i) % k_num_entries];
+    auto state = entry.state.load(std::memory_order_acquire);
+    if (state == EntryState::ready && entry.key_digest == key_digest
+        && entry_matches(entry, de)) {
+      return true; // Added by another process.
+    }
+    if (state != EntryState::empty
+        || !entry.state.compare_exchange_strong(state,
+                                                EntryState::writing,
+                                                std::memory_order_acquire)) {
+      continue;
+    }
+
+    entry.return_value = return_value.to_bitmask();
+    entry.key_digest = key_digest;
+    entry.file_digest = file_digest;
+    entry.device = de.device();
+    entry.inode = de.inode();
+    entry.size = de.size();
+    entry.mtime = util::nsec_tot(de.mtime());
+    entry.ctime = util::nsec_tot(de.ctime());
+    entry.state.store(EntryState::ready, std::memory_order_release);
+
+    if (m_config.debug()) {
+      LOG("Build session insert: {}", path);
+    }
+    return true;
+  }
+
+  LOG("No free build session entry for {}", path);
+  return false;
+}
+
+bool
+BuildSession::initialize()
+{
+  if (m_initialized) {
+    return m_sr != nullptr;
+  }
+  m_initialized = true;
+
+  const auto path = get_path(m_config);
+  util::Fd fd(open(util::pstr(path).c_str(), O_RDWR));
+  if (!fd) {
+    return false;
+  }
+  util::set_cloexec_flag(*fd);
+
+  auto map = util::MemoryMap::map(*fd, sizeof(SharedRegion));
+  if (!map) {
+    LOG("Failed to map build session file {}: {}", path, map.error());
+    return false;
+  }
+  auto sr = reinterpret_cast<SharedRegion*>(map->ptr());
+  if (sr->version != k_version) {
+    LOG("Ignoring build session {} with version {} (expected {})",
+        path,
+        sr->version,
+        k_version);
+    return false;
+  }
+
+  m_map = std::move(*map);
+  m_sr = sr;
+  LOG("Using build session {}", path);
+  return true;
+}
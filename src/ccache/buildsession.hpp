@@ -0,0 +1,86 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <ccache/hash.hpp>
+#include <ccache/hashutil.hpp>
+#include <ccache/inodecache.hpp>
+#include <ccache/util/memorymap.hpp>
+
+#include <tl/expected.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+
+class Config;
+
+// A build session is started with `ccache --begin-build` and ended with
+// `ccache --end-build`. While a session is active, ccache processes share the
+// digests of hashed files through a table in a file mapped into shared memory,
+// so that a header included by many translation units in a parallel build only
+// needs to be read and hashed by the first process that sees it.
+//
+// Entries are keyed by path and validated against the file's current status
+// information (device, inode, size, mtime and ctime) on lookup, so a file that
+// changes during the session is simply hashed again. The table is insert-only
+// and lives only as long as the session, so no locking or eviction is needed.
+class BuildSession
+{
+public:
+  // `min_age` has the same meaning as for InodeCache::InodeCache.
+  BuildSession(const Config& config,
+               std::chrono::nanoseconds min_age = std::chrono::seconds(2));
+
+  // Start a new session unless one is already active.
+  static tl::expected<void, std::string> begin(const Config& config);
+
+  // End the active session. Returns false if there was no active session.
+  static tl::expected<bool, std::string> end(const Config& config);
+
+  static std::filesystem::path get_path(const Config& config);
+
+  // Get hash digest and return value of a previous call to do_hash_file() in
+  // hashutil.cpp, made by this or another process in the session.
+  std::optional<std::pair<SourceCodeScanResult, Hash::Digest>>
+  get(const std::filesystem::path& path, InodeCache::ContentType type);
+
+  // Put hash digest and return value from a successful call to do_hash_file()
+  // in hashutil.cpp.
+  //
+  // Returns true if the values could be stored in the session, false otherwise.
+  bool put(const std::filesystem::path& path,
+           InodeCache::ContentType type,
+           const Hash::Digest& file_digest,
+           SourceCodeScanResult return_value);
+
+private:
+  struct Entry;
+  struct SharedRegion;
+
+  bool initialize();
+
+  const Config& m_config;
+  std::chrono::nanoseconds m_min_age;
+  SharedRegion* m_sr = nullptr;
+  bool m_initialized = false;
+  util::MemoryMap m_map;
+};
@@ -64,6 +64,7 @@
 #include <ccache/util/string.hpp>
 #include <ccache/util/temporaryfile.hpp>
 #include <ccache/util/time.hpp>
+#include <ccache/util/timer.hpp>
 #include <ccache/util/tokenizer.hpp>
 #include <ccache/util/umaskscope.hpp>
 #include <ccache/util/wincompat.hpp>
@@ -542,12 +543,26 @@ contains_incbin_directive(std::string_view data)
   return false;
 }
 
+// State kept between calls to do_process_preprocessed_data when the
+// preprocessed data is processed in several chunks.
+struct PreprocessedDataState
+{
+  std::unordered_map<std::string, fs::path> relative_inc_path_cache;
+  bool found_incbin = false;
+  bool found_pch = false;
+};
+
+// Hash `data`, which must consist of complete lines, and remember the included
+// files it mentions. `data` may be modified.
 static tl::expected<void, Failure>
-do_process_preprocessed_data(Context& ctx, Hash& hash, util::Bytes&& data)
+do_process_preprocessed_data(Context& ctx,
+                             Hash& hash,
+                             std::span<uint8_t> data,
+                             PreprocessedDataState& state)
 {
   ASSERT(!data.empty());
 
-  std::unordered_map<std::string, fs::path> relative_inc_path_cache;
+  auto& relative_inc_path_cache = state.relative_inc_path_cache;
 
   // Bytes between p and q are pending to be hashed.
   char* q = reinterpret_cast<char*>(data.data());
@@ -678,6 +693,9 @@ do_process_preprocessed_data(Context& ctx, Hash& hash, util::Bytes&& data)
         hash.hash(inc_path);
       }
 
+      if (is_precompiled_header(inc_path)) {
+        state.found_pch = true;
+      }
       TRY(remember_include_file(ctx, inc_path, hash, system, nullptr));
       p = q; // Everything of interest between p and q has been hashed now.
     } else if (strncmp(q, "___________", 10) == 0
@@ -703,10 +721,24 @@ do_process_preprocessed_data(Context& ctx, Hash& hash, util::Bytes&& data)
   // In direct mode we have searched for incbin directives via
   // hash_source_code_file, so we only need to search here if direct mode is
   // disabled.
-  if (!ctx.config.direct_mode()
-      // note: not using is_compiler_group_msvc() since clang-cl knows .incbin
-      && ctx.config.compiler_type() != CompilerType::msvc
+  if (!state.found_incbin && !ctx.config.direct_mode()
       && contains_incbin_directive(util::to_string_view(data))) {
+    state.found_incbin = true;
+  }
+
+  hash.hash(p, (end - p));
+
+  return {};
+}
+
+static tl::expected<void, Failure>
+finish_processing_preprocessed_data(Context& ctx,
+                                    Hash& hash,
+                                    const PreprocessedDataState& state)
+{
+  if (state.found_incbin
+      // note: not using is_compiler_group_msvc() since clang-cl knows .incbin
+      && ctx.config.compiler_type() != CompilerType::msvc) {
     if (!ctx.config.sloppiness().contains(core::Sloppy::incbin)) {
       // An assembler .inc bin (without the space) statement, which could be
       // part of inline assembly, refers to an external file. If the file
@@ -721,7 +753,14 @@ do_process_preprocessed_data(Context& ctx, Hash& hash, util::Bytes&& data)
       "");
   }
 
-  hash.hash(p, (end - p));
+  // Explicitly check the .gch/.pch/.pth file as Clang does not include any
+  // mention of it in the preprocessed output.
+  TRY(check_included_pch_file(ctx, hash));
+
+  bool debug_included = getenv("CCACHE_DEBUG_INCLUDED");
+  if (debug_included) {
+    print_included_files(ctx, stdout);
+  }
 
   return {};
 }
@@ -735,31 +774,74 @@ do_process_preprocessed_data(Context& ctx, Hash& hash, util::Bytes&& data)
 static tl::expected<void, Failure>
 process_preprocessed_data(Context& ctx, Hash& hash, util::Bytes&& data)
 {
+  PreprocessedDataState state;
   if (!data.empty()) {
-    TRY(do_process_preprocessed_data(ctx, hash, std::move(data)));
-  }
-
-  // Explicitly check the .gch/.pch/.pth file as Clang does not include any
-  // mention of it in the preprocessed output.
-  TRY(check_included_pch_file(ctx, hash));
-
-  bool debug_included = getenv("CCACHE_DEBUG_INCLUDED");
-  if (debug_included) {
-    print_included_files(ctx, stdout);
+    TRY(do_process_preprocessed_data(ctx, hash, data, state));
   }
-
-  return {};
+  return finish_processing_preprocessed_data(ctx, hash, state);
 }
 
+// Like process_preprocessed_data but for a preprocessed input file. The file is
+// hashed separately and its digest is added to `hash` so that the digest can be
+// stored in the inode cache.
 static tl::expected<void, Failure>
 process_preprocessed_file(Context& ctx, Hash& hash, const fs::path& path)
 {
+#ifdef INODE_CACHE_SUPPORTED
+  // The included files found in the linemarkers are only needed for the direct
+  // mode manifest, and the hashed data only depends on the file content if
+  // paths are not rewritten, so only use the inode cache in that case.
+  const bool use_inode_cache =
+    ctx.config.inode_cache() && !ctx.config.direct_mode()
+    && ctx.config.base_dirs().empty() && ctx.config.hash_dir();
+  const auto content_type = InodeCache::ContentType::preprocessed;
+
+  if (use_inode_cache) {
+    auto result = ctx.build_session.get(path, content_type);
+    if (!result) {
+      result = ctx.inode_cache.get(path, content_type);
+      if (result) {
+        ctx.build_session.put(
+          path, content_type, result->second, result->first);
+      }
+    }
+    if (result) {
+      hash.hash(util::format_base16(result->second));
+      PreprocessedDataState state;
+      state.found_incbin = result->first.contains(SourceCodeScan::found_incbin);
+      return finish_processing_preprocessed_data(ctx, hash, state);
+    }
+  }
+#endif
+
   auto data = util::read_file<util::Bytes>(path);
   if (!data) {
     LOG("Failed to read {}: {}", path, data.error());
     return tl::unexpected(Statistic::internal_error);
   }
-  return process_preprocessed_data(ctx, hash, std::move(*data));
+
+  Hash file_hash;
+  PreprocessedDataState state;
+  if (!data->empty()) {
+    TRY(do_process_preprocessed_data(ctx, file_hash, *data, state));
+  }
+  const auto digest = file_hash.digest();
+  hash.hash(util::format_base16(digest));
+
+#ifdef INODE_CACHE_SUPPORTED
+  // A precompiled header mentioned in a linemarker is hashed as well, so the
+  // digest does not only depend on the file content in that case.
+  if (use_inode_cache && !state.found_pch) {
+    SourceCodeScanResult result;
+    if (state.found_incbin) {
+      result.insert(SourceCodeScan::found_incbin);
+    }
+    ctx.build_session.put(path, content_type, digest, result);
+    ctx.inode_cache.put(path, content_type, digest, result);
+  }
+#endif
+
+  return finish_processing_preprocessed_data(ctx, hash, state);
 }
 
 // Extract the used includes from the dependency file. Note that we cannot
@@ -806,6 +888,7 @@ result_key_from_depfile(Context& ctx, Hash& hash)
   return hash.digest();
 }
 
+#ifdef _WIN32
 struct GetTmpFdResult
 {
   util::Fd fd;
@@ -828,6 +911,7 @@ get_tmp_fd(Context& ctx,
     return {util::Fd(open(dev_null_path, O_WRONLY | O_BINARY)), dev_null_path};
   }
 }
+#endif
 
 struct DoExecuteResult
 {
@@ -875,10 +959,31 @@ do_execute(Context& ctx, util::Args& args, const bool capture_stdout = true)
     args.erase_last("-fdiagnostics-color");
   }
 
+  util::Bytes stdout_data;
+  util::Bytes stderr_data;
+  int status;
+
+#ifndef _WIN32
+  {
+    util::UmaskScope umask_scope(ctx.original_umask);
+    util::DataReceiver stdout_receiver;
+    if (capture_stdout) {
+      stdout_receiver = [&](auto data) {
+        stdout_data.insert(stdout_data.end(), data);
+      };
+    }
+    const auto result = execute_and_capture(
+      ctx, args.to_argv().data(), stdout_receiver, stderr_data);
+    if (!result) {
+      LOG("Failed to capture compiler output: {}", result.error());
+      return tl::unexpected(Statistic::internal_error);
+    }
+    status = *result;
+  }
+#else
   auto tmp_stdout = get_tmp_fd(ctx, "stdout", capture_stdout);
   auto tmp_stderr = get_tmp_fd(ctx, "stderr", true);
 
-  int status;
   {
     util::UmaskScope umask_scope(ctx.original_umask);
     status = execute(ctx,
@@ -886,26 +991,7 @@ do_execute(Context& ctx, util::Args& args, const bool capture_stdout = true)
                      std::move(tmp_stdout.fd),
                      std::move(tmp_stderr.fd));
   }
-  if (status != 0 && !ctx.diagnostics_color_failed
-      && ctx.config.is_compiler_group_gcc()) {
-    const auto errors = util::read_file<std::string>(tmp_stderr.path);
-    if (errors && errors->find("fdiagnostics-color") != std::string::npos) {
-      // GCC versions older than 4.9 don't understand -fdiagnostics-color, and
-      // non-GCC compilers misclassified as GCC-like might not do it
-      // either. We assume that if the error message contains
-      // "fdiagnostics-color" then the compilation failed due to
-      // -fdiagnostics-color being unsupported and we then retry without the
-      // flag. (Note that there intentionally is no leading dash in
-      // "fdiagnostics-color" since some compilers don't include the dash in the
-      // error message.)
-      LOG("-fdiagnostics-color is unsupported; trying again without it");
 
-      ctx.diagnostics_color_failed = true;
-      return do_execute(ctx, args, capture_stdout);
-    }
-  }
-
-  util::Bytes stdout_data;
   if (capture_stdout) {
     auto stdout_data_result = util::read_file<util::Bytes>(tmp_stdout.path);
     if (!stdout_data_result) {
@@ -914,7 +1000,7 @@ do_execute(Context& ctx, util::Args& args, const bool capture_stdout = true)
           stdout_data_result.error());
       return tl::unexpected(Statistic::missing_cache_file);
     }
-    stdout_data = *stdout_data_result;
+    stdout_data = std::move(*stdout_data_result);
   }
 
   auto stderr_data_result = util::read_file<util::Bytes>(tmp_stderr.path);
@@ -924,12 +1010,33 @@ do_execute(Context& ctx, util::Args& args, const bool capture_stdout = true)
         stderr_data_result.error());
     return tl::unexpected(Statistic::missing_cache_file);
   }
+  stderr_data = std::move(*stderr_data_result);
+#endif
 
-  return DoExecuteResult{status, stdout_data, *stderr_data_result};
+  if (status != 0 && !ctx.diagnostics_color_failed
+      && ctx.config.is_compiler_group_gcc()
+      && util::to_string_view(stderr_data).find("fdiagnostics-color")
+           != std::string_view::npos) {
+    // GCC versions older than 4.9 don't understand -fdiagnostics-color, and
+    // non-GCC compilers misclassified as GCC-like might not do it either. We
+    // assume that if the error message contains "fdiagnostics-color" then the
+    // compilation failed due to -fdiagnostics-color being unsupported and we
+    // then retry without the flag. (Note that there intentionally is no leading
+    // dash in "fdiagnostics-color" since some compilers don't include the dash
+    // in the error message.)
+    LOG("-fdiagnostics-color is unsupported; trying again without it");
+
+    ctx.diagnostics_color_failed = true;
+    return do_execute(ctx, args, capture_stdout);
+  }
+
+  return DoExecuteResult{
+    status, std::move(stdout_data), std::move(stderr_data)};
 }
 
 static void
-read_manifest(Context& ctx, std::span<const uint8_t> cache_entry_data)
+read_manifest(core::Manifest& manifest,
+              std::span<const uint8_t> cache_entry_data)
 {
   try {
     core::CacheEntry cache_entry(cache_entry_data);
@@ -940,12 +1047,49 @@ read_manifest(Context& ctx, std::span<const uint8_t> cache_entry_data)
             static_cast<uint8_t>(cache_entry.header().entry_type)));
     }
     cache_entry.verify_checksum();
-    ctx.manifest.read(cache_entry.payload());
+    manifest.read(cache_entry.payload());
   } catch (const core::Error& e) {
     LOG("Error reading manifest: {}", e.what());
   }
 }
 
+// Serialize a cache entry to be stored under `key`, choosing compression level
+// per entry if compression_level is "adaptive", and record compression
+// statistics.
+static util::Bytes
+serialize_cache_entry(Context& ctx,
+                      const Hash::Digest& key,
+                      core::CacheEntryType type,
+                      core::Serializer& serializer)
+{
+  core::CacheEntry::Header header(ctx.config, type);
+  if (type == core::CacheEntryType::result) {
+    header.compile_time = ctx.compile_time_ms;
+  }
+  if (header.compression_type != core::CompressionType::zstd) {
+    return core::CacheEntry::serialize(header, serializer);
+  }
+  if (header.adaptive_compression_level && !ctx.config.remote_only()) {
+    header.write_bandwidth = ctx.storage.local.estimated_write_bandwidth(key);
+  }
+
+  util::Bytes payload;
+  serializer.serialize(payload);
+  util::Timer timer;
+  auto data = core::CacheEntry::serialize(header, payload);
+  const auto microseconds = static_cast<int64_t>(timer.measure_s() * 1'000'000);
+
+  const core::CacheEntry::Header written_header(data);
+  ctx.storage.local.increment_statistic(
+    Statistic::compression_input_byte,
+    static_cast<int64_t>(written_header.entry_size));
+  ctx.storage.local.increment_statistic(Statistic::compression_output_byte,
+                                        static_cast<int64_t>(data.size()));
+  ctx.storage.local.increment_statistic(Statistic::compression_microsecond,
+                                        microseconds);
+  return data;
+}
+
 static void
 update_manifest(Context& ctx,
                 const Hash::Digest& manifest_key,
@@ -981,9 +1125,32 @@ update_manifest(Context& ctx,
     });
   if (added) {
     LOG("Added result key to manifest {}", util::format_base16(manifest_key));
-    core::CacheEntry::Header header(ctx.config, core::CacheEntryType::manifest);
-    ctx.storage.put(manifest_key,
-                    core::CacheEntry::serialize(header, ctx.manifest));
+    if (ctx.config.recache()) {
+      // The stored manifest was not read, so replace it.
+      ctx.storage.put(manifest_key,
+                      serialize_cache_entry(ctx,
+                                            manifest_key,
+                                            core::CacheEntryType::manifest,
+                                            ctx.manifest));
+      return;
+    }
+    // Another process may have stored other results in the manifest since it
+    // was read, so merge with the stored manifest to not lose them.
+    ctx.storage.merge(manifest_key, [&](std::optional<util::Bytes>&& current) {
+      if (!current) {
+        return serialize_cache_entry(
+          ctx, manifest_key, core::CacheEntryType::manifest, ctx.manifest);
+      }
+      core::Manifest merged;
+      read_manifest(merged, *current);
+      util::Bytes payload;
+      ctx.manifest.serialize(payload);
+      // Results of ctx.manifest are added last so that the new result stays the
+      // newest.
+      merged.read(payload);
+      return serialize_cache_entry(
+        ctx, manifest_key, core::CacheEntryType::manifest, merged);
+    });
   } else {
     LOG("Did not add result key to manifest {}",
         util::format_base16(manifest_key));
@@ -1132,8 +1299,8 @@ write_result(Context& ctx,
     return false;
   }
 
-  core::CacheEntry::Header header(ctx.config, core::CacheEntryType::result);
-  const auto cache_entry_data = core::CacheEntry::serialize(header, serializer);
+  const auto cache_entry_data = serialize_cache_entry(
+    ctx, result_key, core::CacheEntryType::result, serializer);
 
   if (!ctx.config.remote_only()) {
     const auto& raw_files = serializer.get_raw_files();
@@ -1307,7 +1474,9 @@ to_cache(Context& ctx,
   LOG("Running real compiler");
 
   tl::expected<DoExecuteResult, Failure> result;
+  util::Timer compile_timer;
   result = do_execute(ctx, args);
+  ctx.compile_time_ms = static_cast<uint32_t>(compile_timer.measure_ms());
 
   if (!result) {
     return tl::unexpected(result.error());
@@ -1396,6 +1565,8 @@ to_cache(Context& ctx,
         ctx, *result_key, result->stdout_data, result->stderr_data)) {
     return tl::unexpected(Statistic::compiler_produced_no_output);
   }
+  ctx.storage.local.increment_statistic(Statistic::compile_time_millisecond,
+                                        ctx.compile_time_ms);
 
   // Everything OK.
   core::send_to_console(
@@ -1435,6 +1606,115 @@ get_clang_cu_enable_verbose_mode(const util::Args& args)
   return false;
 }
 
+static tl::expected<void, Failure>
+check_preprocessor_result(const Context& ctx, const DoExecuteResult& result)
+{
+  if (result.exit_status != 0) {
+    LOG("Preprocessor gave exit status {}", result.exit_status);
+    return tl::unexpected(Statistic::preprocessor_error);
+  }
+
+  if (ctx.config.is_compiler_group_msvc() && ctx.config.msvc_utf8()) {
+    // Check that usage of -utf-8 didn't garble the preprocessor output.
+    static constexpr char warning_c4828[] =
+      "warning C4828: The file contains a character starting at offset";
+    if (util::to_string_view(result.stderr_data).find(warning_c4828)
+        != std::string_view::npos) {
+      LOG("Non-UTF-8 source code unsupported in preprocessor mode");
+      return tl::unexpected(Statistic::unsupported_source_encoding);
+    }
+  }
+
+  return {};
+}
+
+#ifndef _WIN32
+// Run the preprocessor with standard output connected to a pipe and hash the
+// output while the preprocessor is running instead of first writing it to a
+// temporary file. Returns standard error output from the preprocessor.
+static tl::expected<util::Bytes, Failure>
+run_preprocessor_with_piped_output(Context& ctx, util::Args& args, Hash& hash)
+{
+  PreprocessedDataState state;
+  tl::expected<void, Failure> process_result;
+  util::Bytes pending; // Data not yet processed, ends with an incomplete line.
+  util::Bytes stderr_data;
+
+  tl::expected<int, std::string> status;
+  {
+    util::UmaskScope umask_scope(ctx.original_umask);
+    status = execute_and_capture(
+      ctx, args.to_argv().data(), [&](auto data) {
+        if (!process_result) {
+          return; // Just drain the pipe so that the preprocessor can finish.
+        }
+        pending.insert(pending.end(), data);
+        size_t complete_size = pending.size();
+        while (complete_size > 0 && pending[complete_size - 1] != '\n') {
+          --complete_size;
+        }
+        if (complete_size == 0) {
+          return;
+        }
+        process_result = do_process_preprocessed_data(
+          ctx, hash, std::span(pending.data(), complete_size), state);
+        pending.erase(pending.begin(), complete_size);
+      },
+      stderr_data);
+  }
+  if (!status) {
+    LOG("Failed to capture preprocessor output: {}", status.error());
+    return tl::unexpected(Statistic::internal_error);
+  }
+
+  DoExecuteResult result{*status, {}, std::move(stderr_data)};
+  TRY(check_preprocessor_result(ctx, result));
+
+  TRY(process_result);
+  if (!pending.empty()) {
+    TRY(do_process_preprocessed_data(ctx, hash, pending, state));
+  }
+  TRY(finish_processing_preprocessed_data(ctx, hash, state));
+
+  return std::move(result.stderr_data);
+}
+#endif
+
+// Run the preprocessor and hash its output. Returns standard error output from
+// the preprocessor.
+static tl::expected<util::Bytes, Failure>
+run_preprocessor(Context& ctx,
+                 util::Args& args,
+                 Hash& hash,
+                 const bool is_clang_cu)
+{
+#ifndef _WIN32
+  if (!is_clang_cu) {
+    hash.hash_delimiter("cpp");
+    return run_preprocessor_with_piped_output(ctx, args, hash);
+  }
+#endif
+
+  auto result = do_execute(ctx, args);
+  if (!result) {
+    return tl::unexpected(result.error());
+  }
+  TRY(check_preprocessor_result(ctx, *result));
+
+  if (is_clang_cu) {
+    auto chunks = compiler::split_preprocessed_output_from_clang_cuda(
+      util::to_string_view(result->stdout_data));
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      TRY(process_cuda_chunk(ctx, hash, chunks[i], i));
+    }
+  } else {
+    hash.hash_delimiter("cpp");
+    TRY(process_preprocessed_data(ctx, hash, std::move(result->stdout_data)));
+  }
+
+  return std::move(result->stderr_data);
+}
+
 // Find the result key by running the compiler in preprocessor mode and
 // hashing the result.
 static tl::expected<Hash::Digest, Failure>
@@ -1479,40 +1759,13 @@ get_result_key_from_cpp(Context& ctx, util::Args& args, Hash& hash)
 
     add_prefix(ctx, args, ctx.config.prefix_command_cpp());
     LOG("Running preprocessor");
-    auto result = do_execute(ctx, args);
+    auto stderr_data = run_preprocessor(ctx, args, hash, is_clang_cu);
     args.pop_back(args.size() - orig_args_size);
 
-    if (!result) {
-      return tl::unexpected(result.error());
-    } else if (result->exit_status != 0) {
-      LOG("Preprocessor gave exit status {}", result->exit_status);
-      return tl::unexpected(Statistic::preprocessor_error);
-    }
-
-    cpp_stderr_data = std::move(result->stderr_data);
-
-    if (ctx.config.is_compiler_group_msvc() && ctx.config.msvc_utf8()) {
-      // Check that usage of -utf-8 didn't garble the preprocessor output.
-      static constexpr char warning_c4828[] =
-        "warning C4828: The file contains a character starting at offset";
-      if (util::to_string_view(cpp_stderr_data).find(warning_c4828)
-          != std::string_view::npos) {
-        LOG("Non-UTF-8 source code unsupported in preprocessor mode");
-        return tl::unexpected(Statistic::unsupported_source_encoding);
-      }
-    }
-
-    if (is_clang_cu) {
-      auto chunks = compiler::split_preprocessed_output_from_clang_cuda(
-        util::to_string_view(result->stdout_data));
-      for (size_t i = 0; i < chunks.size(); ++i) {
-        TRY(process_cuda_chunk(ctx, hash, chunks[i], i));
-      }
-    } else {
-      hash.hash_delimiter("cpp");
-
-      TRY(process_preprocessed_data(ctx, hash, std::move(result->stdout_data)));
+    if (!stderr_data) {
+      return tl::unexpected(stderr_data.error());
     }
+    cpp_stderr_data = std::move(*stderr_data);
   }
 
   hash.hash_delimiter("cppstderr");
@@ -2517,8 +2770,16 @@ get_result_key_from_manifest(Context& ctx, const Hash::Digest& manifest_key)
   ctx.storage.get(
     manifest_key, core::CacheEntryType::manifest, [&](const auto& value) {
       try {
-        read_manifest(ctx, value);
+        read_manifest(ctx.manifest, value);
         ++read_manifests;
+        if (read_manifests == 1) {
+          // Fetch the most likely result from remote storage while checking
+          // the include files in the manifest.
+          const auto newest_result_key = ctx.manifest.newest_result_digest();
+          if (newest_result_key) {
+            ctx.storage.prefetch(*newest_result_key);
+          }
+        }
         result_key = ctx.manifest.look_up_result_digest(ctx);
       } catch (const core::Error& e) {
         LOG("Failed to look up result key in manifest: {}", e.what());
@@ -2534,10 +2795,11 @@ get_result_key_from_manifest(Context& ctx, const Hash::Digest& manifest_key)
   if (read_manifests > 1 && !ctx.config.remote_only()) {
     LOG("Storing merged manifest {} locally",
         util::format_base16(manifest_key));
-    core::CacheEntry::Header header(ctx.config, core::CacheEntryType::manifest);
-    ctx.storage.local.put(manifest_key,
-                          core::CacheEntry::serialize(header, ctx.manifest),
-                          storage::Overwrite::yes);
+    ctx.storage.local.put(
+      manifest_key,
+      serialize_cache_entry(
+        ctx, manifest_key, core::CacheEntryType::manifest, ctx.manifest),
+      storage::Overwrite::yes);
   }
 
   return result_key;
@@ -2680,6 +2942,7 @@ from_cache(Context& ctx, FromCacheCallMode mode, const Hash::Digest& result_key)
     return false;
   }
 
+  uint32_t compile_time_ms = 0;
   try {
     core::CacheEntry cache_entry(cache_entry_data);
     if (cache_entry.header().entry_type != core::CacheEntryType::result) {
@@ -2693,6 +2956,7 @@ from_cache(Context& ctx, FromCacheCallMode mode, const Hash::Digest& result_key)
     core::ResultRetriever result_retriever(ctx, result_key);
     util::UmaskScope umask_scope(ctx.original_umask);
     deserializer.visit(result_retriever);
+    compile_time_ms = cache_entry.header().compile_time;
   } catch (core::ResultRetriever::WriteError& e) {
     LOG("Write error when retrieving result from {}: {}",
         util::format_base16(result_key),
@@ -2706,6 +2970,18 @@ from_cache(Context& ctx, FromCacheCallMode mode, const Hash::Digest& result_key)
   }
 
   LOG("Succeeded getting cached result");
+
+  // The hit saved the time it took to compile the result minus the time spent
+  // by this invocation.
+  const int64_t saved_ms =
+    int64_t{compile_time_ms}
+    - std::chrono::duration_cast<std::chrono::milliseconds>(
+        util::now() - ctx.time_of_invocation)
+        .count();
+  if (saved_ms > 0) {
+    ctx.storage.local.increment_statistic(
+      Statistic::compile_time_saved_millisecond, saved_ms);
+  }
   return true;
 }
 
@@ -2815,10 +3091,12 @@ log_result_to_stats_log(Context& ctx)
   }
 
   core::Statistics statistics(ctx.storage.local.get_statistics_updates());
-  const auto ids = statistics.get_statistics_ids();
+  auto ids = statistics.get_statistics_ids();
   if (ids.empty()) {
     return;
   }
+  const auto amounts = statistics.get_statistics_amounts();
+  ids.insert(ids.end(), amounts.begin(), amounts.end());
 
   core::StatsLog(ctx.config.stats_log())
     .log_result(ctx.args_info.input_file, ids);
@@ -2960,6 +3238,7 @@ cache_compilation(int argc, const char* const* argv)
       util::set_umask(*original_umask);
     }
     auto execv_argv = saved_orig_args.to_argv();
+    util::logging::flush();
     execute_noreturn(execv_argv.data(), saved_temp_dir);
     throw core::Fatal(
       FMT("execute_noreturn of {} failed: {}", execv_argv[0], strerror(errno)));
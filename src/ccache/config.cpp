@@ -110,6 +110,7 @@ enum class ConfigItem : uint8_t {
   cache_dir,
   ceiling_dirs,
   ceiling_markers,
+  cold_cache_dir,
   compiler,
   compiler_check,
   compiler_type,
@@ -121,6 +122,7 @@ enum class ConfigItem : uint8_t {
   depend_mode,
   direct_mode,
   disable,
+  eviction_policy,
   extra_files_to_hash,
   file_clone,
   hard_link,
@@ -143,11 +145,14 @@ enum class ConfigItem : uint8_t {
   read_only,
   read_only_direct,
   recache,
+  remote_fill_max_size,
+  remote_fill_policy,
   remote_only,
   remote_storage,
   reshare,
   response_file_format,
   safe_dirs,
+  skip_unchanged_outputs,
   sloppiness,
   stats,
   stats_log,
@@ -179,6 +184,7 @@ const std::unordered_map<std::string_view, ConfigKeyTableEntry>
     {"cache_dir",                  {C::cache_dir,                  DCP::reject}},
     {"ceiling_dirs",               {C::ceiling_dirs,               DCP::reject}},
     {"ceiling_markers",            {C::ceiling_markers,            DCP::reject}},
+    {"cold_cache_dir",             {C::cold_cache_dir,             DCP::reject}},
     {"compiler",                   {C::compiler,                   DCP::unsafe}},
     {"compiler_check",             {C::compiler_check,             DCP::unsafe}}, // exception: some strings allowed
     {"compiler_type",              {C::compiler_type,              DCP::allow}},
@@ -190,6 +196,7 @@ const std::unordered_map<std::string_view, ConfigKeyTableEntry>
     {"depend_mode",                {C::depend_mode,                DCP::allow}},
     {"direct_mode",                {C::direct_mode,                DCP::allow}},
     {"disable",                    {C::disable,                    DCP::allow}},
+    {"eviction_policy",            {C::eviction_policy,            DCP::reject}},
     {"extra_files_to_hash",        {C::extra_files_to_hash,        DCP::allow}},
     {"file_clone",                 {C::file_clone,                 DCP::allow}},
     {"hard_link",                  {C::hard_link,                  DCP::allow}},
@@ -212,12 +219,15 @@ const std::unordered_map<std::string_view, ConfigKeyTableEntry>
     {"read_only",                  {C::read_only,                  DCP::allow}},
     {"read_only_direct",           {C::read_only_direct,           DCP::allow}},
     {"recache",                    {C::recache,                    DCP::allow}},
+    {"remote_fill_max_size",       {C::remote_fill_max_size,       DCP::allow}},
+    {"remote_fill_policy",         {C::remote_fill_policy,         DCP::allow}},
     {"remote_only",                {C::remote_only,                DCP::allow}},
     {"remote_storage",             {C::remote_storage,             DCP::unsafe}},
     {"reshare",                    {C::reshare,                    DCP::allow}},
     {"response_file_format",       {C::response_file_format,       DCP::allow}},
     {"safe_dirs",                  {C::safe_dirs,                  DCP::reject}},
     {"secondary_storage",          {C::remote_storage,             DCP::unsafe, "remote_storage"}},
+    {"skip_unchanged_outputs",     {C::skip_unchanged_outputs,     DCP::allow}},
     {"sloppiness",                 {C::sloppiness,                 DCP::allow}},
     {"stats",                      {C::stats,                      DCP::allow}},
     {"stats_log",                  {C::stats_log,                  DCP::unsafe}},
@@ -233,6 +243,7 @@ const std::unordered_map<std::string_view, std::string_view>
     {"CC",                   "compiler"                  }, // Alias for CCACHE_COMPILER
     {"CEILING_DIRS",         "ceiling_dirs"              },
     {"CEILING_MARKERS",      "ceiling_markers"           },
+    {"COLDDIR",              "cold_cache_dir"            },
     {"COMMENTS",             "keep_comments_cpp"         },
     {"COMPILER",             "compiler"                  },
     {"COMPILERCHECK",        "compiler_check"            },
@@ -246,6 +257,7 @@ const std::unordered_map<std::string_view, std::string_view>
     {"DIR",                  "cache_dir"                 },
     {"DIRECT",               "direct_mode"               },
     {"DISABLE",              "disable"                   },
+    {"EVICTION_POLICY",      "eviction_policy"           },
     {"EXTRAFILES",           "extra_files_to_hash"       },
     {"FILECLONE",            "file_clone"                },
     {"HARDLINK",             "hard_link"                 },
@@ -267,12 +279,15 @@ const std::unordered_map<std::string_view, std::string_view>
     {"READONLY",             "read_only"                 },
     {"READONLY_DIRECT",      "read_only_direct"          },
     {"RECACHE",              "recache"                   },
+    {"REMOTE_FILL_MAX_SIZE", "remote_fill_max_size"      },
+    {"REMOTE_FILL_POLICY",   "remote_fill_policy"        },
     {"REMOTE_ONLY",          "remote_only"               },
     {"REMOTE_STORAGE",       "remote_storage"            },
     {"RESHARE",              "reshare"                   },
     {"RESPONSE_FILE_FORMAT", "response_file_format"      },
     {"SECONDARY_STORAGE",    "remote_storage"            }, // Alias for CCACHE_REMOTE_STORAGE
     {"SAFE_DIRS",            "safe_dirs"                 },
+    {"SKIPUNCHANGED",        "skip_unchanged_outputs"    },
     {"SLOPPINESS",           "sloppiness"                },
     {"STATS",                "stats"                     },
     {"STATSLOG",             "stats_log"                 },
@@ -280,6 +295,34 @@ const std::unordered_map<std::string_view, std::string_view>
     {"UMASK",                "umask"                     },
 };
 
+EvictionPolicy
+parse_eviction_policy(const std::string& value)
+{
+  if (value == "cost") {
+    return EvictionPolicy::cost;
+  } else if (value == "lru") {
+    return EvictionPolicy::lru;
+  } else {
+    throw core::Error(FMT("unknown eviction policy: \"{}\"", value));
+  }
+}
+
+RemoteFillPolicy
+parse_remote_fill_policy(const std::string& value)
+{
+  if (value == "always") {
+    return RemoteFillPolicy::always;
+  } else if (value == "frequency") {
+    return RemoteFillPolicy::frequency;
+  } else if (value == "never") {
+    return RemoteFillPolicy::never;
+  } else if (value == "size") {
+    return RemoteFillPolicy::size;
+  } else {
+    throw core::Error(FMT("unknown remote fill policy: \"{}\"", value));
+  }
+}
+
 util::Args::ResponseFileFormat
 parse_response_file_format(const std::string& value)
 {
@@ -564,6 +607,47 @@ home_directory()
 #endif
 }
 
+std::string
+format_size(uint64_t size, util::SizeUnitPrefixType prefix_type)
+{
+  auto result = util::format_human_readable_size(size, prefix_type);
+  if (result.ends_with(" bytes")) {
+    // Special case to make the output parsable by util::parse_size.
+    result.resize(result.size() - 6);
+  }
+  return result;
+}
+
+std::string
+eviction_policy_to_string(EvictionPolicy eviction_policy)
+{
+  switch (eviction_policy) {
+  case EvictionPolicy::cost:
+    return "cost";
+  case EvictionPolicy::lru:
+    return "lru";
+  }
+
+  ASSERT(false);
+}
+
+std::string
+remote_fill_policy_to_string(RemoteFillPolicy remote_fill_policy)
+{
+  switch (remote_fill_policy) {
+  case RemoteFillPolicy::always:
+    return "always";
+  case RemoteFillPolicy::frequency:
+    return "frequency";
+  case RemoteFillPolicy::never:
+    return "never";
+  case RemoteFillPolicy::size:
+    return "size";
+  }
+
+  ASSERT(false);
+}
+
 std::string
 response_file_format_to_string(
   util::Args::ResponseFileFormat response_file_format)
@@ -1025,6 +1109,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::ceiling_markers:
     return util::join_path_list(m_ceiling_markers);
 
+  case ConfigItem::cold_cache_dir:
+    return m_cold_cache_dir.string();
+
   case ConfigItem::compiler:
     return m_compiler;
 
@@ -1038,7 +1125,8 @@ Config::get_string_value(const std::string& key) const
     return format_bool(m_compression);
 
   case ConfigItem::compression_level:
-    return FMT("{}", m_compression_level);
+    return m_compression_level_adaptive ? "adaptive"
+                                        : FMT("{}", m_compression_level);
 
   case ConfigItem::debug:
     return format_bool(m_debug);
@@ -1058,6 +1146,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::disable:
     return format_bool(m_disable);
 
+  case ConfigItem::eviction_policy:
+    return eviction_policy_to_string(m_eviction_policy);
+
   case ConfigItem::extra_files_to_hash:
     return m_extra_files_to_hash;
 
@@ -1091,15 +1182,8 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::max_files:
     return FMT("{}", m_max_files);
 
-  case ConfigItem::max_size: {
-    auto result =
-      util::format_human_readable_size(m_max_size, m_size_prefix_type);
-    if (result.ends_with(" bytes")) {
-      // Special case to make the output parsable by util::parse_size.
-      result.resize(result.size() - 6);
-    }
-    return result;
-  }
+  case ConfigItem::max_size:
+    return format_size(m_max_size, m_size_prefix_type);
 
   case ConfigItem::msvc_dep_prefix:
     return m_msvc_dep_prefix;
@@ -1131,6 +1215,12 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::recache:
     return format_bool(m_recache);
 
+  case ConfigItem::remote_fill_max_size:
+    return format_size(m_remote_fill_max_size, m_size_prefix_type);
+
+  case ConfigItem::remote_fill_policy:
+    return remote_fill_policy_to_string(m_remote_fill_policy);
+
   case ConfigItem::remote_only:
     return format_bool(m_remote_only);
 
@@ -1146,6 +1236,9 @@ Config::get_string_value(const std::string& key) const
   case ConfigItem::safe_dirs:
     return util::join_path_list(m_safe_dirs);
 
+  case ConfigItem::skip_unchanged_outputs:
+    return format_bool(m_skip_unchanged_outputs);
+
   case ConfigItem::sloppiness:
     return format_sloppiness(m_sloppiness);
 
@@ -1292,6 +1385,10 @@ Config::set_item(const std::string_view& key,
     set_ceiling_markers(util::split_path_list(value));
     break;
 
+  case ConfigItem::cold_cache_dir:
+    m_cold_cache_dir = util::lexically_normal(value);
+    break;
+
   case ConfigItem::compiler:
     m_compiler = value;
     break;
@@ -1309,8 +1406,13 @@ Config::set_item(const std::string_view& key,
     break;
 
   case ConfigItem::compression_level:
-    m_compression_level = static_cast<int8_t>(util::value_or_throw<core::Error>(
-      util::parse_signed(value, INT8_MIN, INT8_MAX, "compression_level")));
+    m_compression_level_adaptive = value == "adaptive";
+    m_compression_level = 0;
+    if (!m_compression_level_adaptive) {
+      m_compression_level = static_cast<int8_t>(
+        util::value_or_throw<core::Error>(util::parse_signed(
+          value, INT8_MIN, INT8_MAX, "compression_level")));
+    }
     break;
 
   case ConfigItem::debug:
@@ -1338,6 +1440,10 @@ Config::set_item(const std::string_view& key,
     m_disable = parse_bool(value, env_var_key, negate);
     break;
 
+  case ConfigItem::eviction_policy:
+    m_eviction_policy = parse_eviction_policy(value);
+    break;
+
   case ConfigItem::extra_files_to_hash:
     m_extra_files_to_hash = value;
     break;
@@ -1431,6 +1537,15 @@ Config::set_item(const std::string_view& key,
     m_recache = parse_bool(value, env_var_key, negate);
     break;
 
+  case ConfigItem::remote_fill_max_size:
+    m_remote_fill_max_size =
+      util::value_or_throw<core::Error>(util::parse_size(value)).first;
+    break;
+
+  case ConfigItem::remote_fill_policy:
+    m_remote_fill_policy = parse_remote_fill_policy(value);
+    break;
+
   case ConfigItem::remote_only:
     m_remote_only = parse_bool(value, env_var_key, negate);
     break;
@@ -1451,6 +1566,10 @@ Config::set_item(const std::string_view& key,
     set_safe_dirs(util::split_path_list(value));
     break;
 
+  case ConfigItem::skip_unchanged_outputs:
+    m_skip_unchanged_outputs = parse_bool(value, env_var_key, negate);
+    break;
+
   case ConfigItem::sloppiness:
     m_sloppiness = parse_sloppiness(value);
     break;
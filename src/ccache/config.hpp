@@ -51,6 +51,20 @@ enum class CompilerType {
 
 std::string compiler_type_to_string(CompilerType compiler_type);
 
+// Policy for storing entries fetched from remote storage in local storage.
+enum class RemoteFillPolicy {
+  always,    // Store all entries.
+  frequency, // Store entries that have been fetched repeatedly.
+  never,     // Store no entries.
+  size       // Store entries not larger than remote_fill_max_size.
+};
+
+// Policy for choosing which entries to remove when the local cache is full.
+enum class EvictionPolicy {
+  cost, // Remove entries that save the least compile time per byte first.
+  lru   // Remove least recently used entries first.
+};
+
 class Config : util::NonCopyable
 {
 public:
@@ -66,17 +80,20 @@ public:
   const std::filesystem::path& cache_dir() const;
   const std::vector<std::filesystem::path>& ceiling_dirs() const;
   const std::vector<std::filesystem::path>& ceiling_markers() const;
+  const std::filesystem::path& cold_cache_dir() const;
   const std::string& compiler() const;
   const std::string& compiler_check() const;
   CompilerType compiler_type() const;
   bool compression() const;
   int8_t compression_level() const;
+  bool compression_level_adaptive() const;
   bool debug() const;
   const std::filesystem::path& debug_dir() const;
   uint8_t debug_level() const;
   bool depend_mode() const;
   bool direct_mode() const;
   bool disable() const;
+  EvictionPolicy eviction_policy() const;
   const std::string& extra_files_to_hash() const;
   bool file_clone() const;
   bool hard_link() const;
@@ -98,11 +115,14 @@ public:
   bool read_only() const;
   bool read_only_direct() const;
   bool recache() const;
+  uint64_t remote_fill_max_size() const;
+  RemoteFillPolicy remote_fill_policy() const;
   bool remote_only() const;
   const std::string& remote_storage() const;
   bool reshare() const;
   util::Args::ResponseFileFormat response_file_format() const;
   const std::vector<std::filesystem::path>& safe_dirs() const;
+  bool skip_unchanged_outputs() const;
   core::Sloppiness sloppiness() const;
   bool stats() const;
   const std::filesystem::path& stats_log() const;
@@ -195,17 +215,20 @@ private:
   std::filesystem::path m_cache_dir;
   std::vector<std::filesystem::path> m_ceiling_dirs;
   std::vector<std::filesystem::path> m_ceiling_markers = {".git"};
+  std::filesystem::path m_cold_cache_dir;
   std::string m_compiler;
   std::string m_compiler_check = "mtime";
   CompilerType m_compiler_type = CompilerType::auto_guess;
   bool m_compression = true;
   int8_t m_compression_level = 0; // Use default level
+  bool m_compression_level_adaptive = false;
   bool m_debug = false;
   std::filesystem::path m_debug_dir;
   uint8_t m_debug_level = 2;
   bool m_depend_mode = false;
   bool m_direct_mode = true;
   bool m_disable = false;
+  EvictionPolicy m_eviction_policy = EvictionPolicy::lru;
   std::string m_extra_files_to_hash;
   bool m_file_clone = false;
   bool m_hard_link = false;
@@ -233,11 +256,14 @@ private:
   bool m_read_only_direct = false;
   bool m_recache = false;
   bool m_reshare = false;
+  uint64_t m_remote_fill_max_size = 1024 * 1024;
+  RemoteFillPolicy m_remote_fill_policy = RemoteFillPolicy::always;
   bool m_remote_only = false;
   std::string m_remote_storage;
   util::Args::ResponseFileFormat m_response_file_format =
     util::Args::ResponseFileFormat::auto_guess;
   std::vector<std::filesystem::path> m_safe_dirs;
+  bool m_skip_unchanged_outputs = false;
   core::Sloppiness m_sloppiness;
   bool m_stats = true;
   std::filesystem::path m_stats_log;
@@ -291,6 +317,12 @@ Config::ceiling_markers() const
   return m_ceiling_markers;
 }
 
+inline const std::filesystem::path&
+Config::cold_cache_dir() const
+{
+  return m_cold_cache_dir;
+}
+
 inline const std::string&
 Config::compiler() const
 {
@@ -350,6 +382,12 @@ Config::compression_level() const
   return m_compression_level;
 }
 
+inline bool
+Config::compression_level_adaptive() const
+{
+  return m_compression_level_adaptive;
+}
+
 inline bool
 Config::debug() const
 {
@@ -386,6 +424,12 @@ Config::disable() const
   return m_disable;
 }
 
+inline EvictionPolicy
+Config::eviction_policy() const
+{
+  return m_eviction_policy;
+}
+
 inline const std::string&
 Config::extra_files_to_hash() const
 {
@@ -512,6 +556,18 @@ Config::recache() const
   return m_recache;
 }
 
+inline uint64_t
+Config::remote_fill_max_size() const
+{
+  return m_remote_fill_max_size;
+}
+
+inline RemoteFillPolicy
+Config::remote_fill_policy() const
+{
+  return m_remote_fill_policy;
+}
+
 inline bool
 Config::remote_only() const
 {
@@ -547,6 +603,12 @@ Config::safe_dirs() const
   return m_safe_dirs;
 }
 
+inline bool
+Config::skip_unchanged_outputs() const
+{
+  return m_skip_unchanged_outputs;
+}
+
 inline core::Sloppiness
 Config::sloppiness() const
 {
@@ -45,6 +45,7 @@ Context::Context(const fs::path& ccache_exe_dir)
     storage(config, ccache_exe_dir),
 #ifdef INODE_CACHE_SUPPORTED
     inode_cache(config),
+    build_session(config),
 #endif
     time_of_invocation(util::now())
 {
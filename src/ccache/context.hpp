@@ -30,11 +30,13 @@
 #include <ccache/util/time.hpp>
 
 #ifdef INODE_CACHE_SUPPORTED
+#  include <ccache/buildsession.hpp>
 #  include <ccache/inodecache.hpp>
 #endif
 
 #include <sys/types.h>
 
+#include <cstdint>
 #include <ctime>
 #include <filesystem>
 #include <optional>
@@ -76,6 +78,9 @@ public:
   // The preprocessor's stderr output.
   util::Bytes cpp_stderr_data;
 
+  // Milliseconds spent running the real compiler, recorded in the result.
+  uint32_t compile_time_ms = 0;
+
   // Headers (or directories with headers) to ignore in manifest mode.
   std::vector<std::filesystem::path> ignore_header_paths;
 
@@ -88,6 +93,10 @@ public:
 #ifdef INODE_CACHE_SUPPORTED
   // InodeCache that caches source file hashes when enabled.
   mutable InodeCache inode_cache;
+
+  // Source file hashes shared with other processes in the current build
+  // session, if any.
+  mutable BuildSession build_session;
 #endif
 
   // Time of ccache invocation.
@@ -29,12 +29,16 @@
 #include <ccache/util/filesystem.hpp>
 #include <ccache/util/format.hpp>
 #include <ccache/util/logging.hpp>
+#include <ccache/util/threadpool.hpp>
 #include <ccache/util/time.hpp>
 #include <ccache/util/xxh3_128.hpp>
 #include <ccache/util/zstd.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <limits>
+#include <thread>
+#include <vector>
 
 namespace fs = util::filesystem;
 
@@ -48,6 +52,7 @@ const size_t k_static_header_fields_size =
   + sizeof(core::CacheEntry::Header::compression_level)
   + sizeof(core::CacheEntry::Header::self_contained)
   + sizeof(core::CacheEntry::Header::creation_time)
+  + sizeof(core::CacheEntry::Header::compile_time)
   + sizeof(core::CacheEntry::Header::entry_size)
   // ccache_version length field:
   + 1
@@ -63,6 +68,128 @@ const size_t k_epilogue_fields_size = sizeof(uint64_t) + sizeof(uint64_t);
 const uint64_t k_max_uncompressed_payload_size =
   std::numeric_limits<uint32_t>::max();
 
+// Magic number variant of the skippable frame with the frame table of a
+// payload.
+const uint8_t k_frame_table_variant = 0xc;
+
+// Frames are decompressed in parallel if at least two of them are at least
+// this large when uncompressed. Smaller frames are not worth starting threads
+// for.
+const uint64_t k_min_parallel_frame_size = 512 * 1024;
+
+struct Frame
+{
+  std::span<const uint8_t> data; // Compressed
+  size_t offset;                 // Offset in uncompressed payload
+  size_t size;                   // Uncompressed size
+};
+
+// Compress `payload` of an entry with `header`. Result entries with at least
+// two file entries large enough to be decompressed in parallel get one frame
+// per file entry and a frame table.
+void
+compress_payload(const core::CacheEntry::Header& header,
+                 std::span<const uint8_t> payload,
+                 util::Bytes& output)
+{
+  const auto parts = header.entry_type == core::CacheEntryType::result
+                       ? core::result::split_file_entries(payload)
+                       : std::vector<std::span<const uint8_t>>{payload};
+  const auto large_parts = std::ranges::count_if(parts, [](const auto part) {
+    return part.size() >= k_min_parallel_frame_size;
+  });
+  if (large_parts < 2) {
+    util::throw_on_error<core::Error>(
+      util::zstd_compress(payload, output, header.compression_level),
+      "Cache entry payload compression error: ");
+    return;
+  }
+
+  util::Bytes table;
+  core::CacheEntryDataWriter writer(table);
+  writer.write_int(static_cast<uint16_t>(parts.size()));
+  util::Bytes frames;
+  for (const auto part : parts) {
+    const size_t frame_start = frames.size();
+    util::throw_on_error<core::Error>(
+      util::zstd_compress(part, frames, header.compression_level),
+      "Cache entry payload compression error: ");
+    writer.write_int<uint64_t>(frames.size() - frame_start);
+    writer.write_int<uint64_t>(part.size());
+  }
+
+  util::zstd_write_skippable_frame(output, k_frame_table_variant, table);
+  output.insert(output.end(), frames);
+}
+
+// Return the frames of `payload` if it has a valid frame table, otherwise an
+// empty vector.
+std::vector<Frame>
+parse_frame_table(std::span<const uint8_t> payload, uint64_t uncompressed_size)
+{
+  const auto table =
+    util::zstd_read_skippable_frame(payload, k_frame_table_variant);
+  if (!table) {
+    return {};
+  }
+
+  std::vector<Frame> frames;
+  auto rest =
+    payload.subspan(util::k_zstd_skippable_frame_header_size + table->size());
+  size_t offset = 0;
+  try {
+    core::CacheEntryDataReader reader(*table);
+    const auto n_frames = reader.read_int<uint16_t>();
+    for (uint16_t i = 0; i < n_frames; ++i) {
+      const auto compressed_size = reader.read_int<uint64_t>();
+      const auto size = reader.read_int<uint64_t>();
+      if (compressed_size > rest.size() || size > uncompressed_size - offset) {
+        return {};
+      }
+      frames.push_back(Frame{rest.first(compressed_size), offset, size});
+      rest = rest.subspan(compressed_size);
+      offset += size;
+    }
+  } catch (const core::Error&) {
+    return {};
+  }
+  if (!rest.empty() || offset != uncompressed_size) {
+    return {};
+  }
+  return frames;
+}
+
+// Decompress `frames` into `output` in parallel if worthwhile. Returns false if
+// not.
+bool
+decompress_frames_in_parallel(const std::vector<Frame>& frames,
+                              util::Bytes& output,
+                              uint64_t uncompressed_size)
+{
+  const auto large_frames =
+    std::ranges::count_if(frames, [](const auto& frame) {
+      return frame.size >= k_min_parallel_frame_size;
+    });
+  const auto threads = std::min<size_t>(
+    static_cast<size_t>(large_frames), std::thread::hardware_concurrency());
+  if (threads < 2) {
+    return false;
+  }
+
+  LOG("Decompressing {} frames with {} threads", frames.size(), threads);
+  output.resize(uncompressed_size);
+  util::ThreadPool thread_pool(threads - 1); // The caller also participates.
+  thread_pool.parallel_for(0, frames.size(), [&](size_t i) {
+    const auto& frame = frames[i];
+    util::throw_on_error<core::Error>(
+      util::zstd_decompress(
+        frame.data,
+        std::span<uint8_t>(output.data() + frame.offset, frame.size)),
+      "Cache entry payload decompression error: ");
+  });
+  return true;
+}
+
 core::CacheEntryType
 cache_entry_type_from_int(const uint8_t entry_type)
 {
@@ -89,7 +216,9 @@ namespace core {
 //   - The checksum is now for the (potentially) compressed payload instead of
 //     the uncompressed payload, and the checksum is now always stored
 //     uncompressed.
-const uint8_t CacheEntry::k_format_version = 1;
+// Version 2:
+//   - Added compile_time field.
+const uint8_t CacheEntry::k_format_version = 2;
 
 CacheEntry::Header::Header(const Config& config,
                            core::CacheEntryType entry_type_)
@@ -101,12 +230,17 @@ CacheEntry::Header::Header(const Config& config,
     self_contained(entry_type != CacheEntryType::result
                    || !core::result::Serializer::use_raw_files(config)),
     creation_time(util::sec(util::now())),
+    compile_time(0),
     ccache_version(CCACHE_VERSION),
     namespace_(config.namespace_()),
     entry_size(0)
 {
   if (compression_type == CompressionType::none) {
     LOG("Using no compression");
+  } else if (config.compression_level_adaptive()) {
+    adaptive_compression_level = true;
+    compression_level = default_compression_level;
+    LOG("Using Zstandard with adaptive compression level");
   } else if (compression_level == 0) {
     compression_level = default_compression_level;
     LOG("Using Zstandard with default compression level {}", compression_level);
@@ -139,6 +273,7 @@ CacheEntry::Header::inspect() const
   result += FMT("Compression level: {}\n", compression_level);
   result += FMT("Self-contained: {}\n", self_contained ? "yes" : "no");
   result += FMT("Creation time: {}\n", creation_time);
+  result += FMT("Compile time: {} ms\n", compile_time);
   result += FMT("Ccache version: {}\n", ccache_version);
   result += FMT("Namespace: {}\n", namespace_);
   result += FMT("Entry size: {}\n", entry_size);
@@ -165,6 +300,7 @@ CacheEntry::Header::parse(std::span<const uint8_t> data)
   reader.read_int(compression_level);
   self_contained = bool(reader.read_int<uint8_t>());
   reader.read_int(creation_time);
+  reader.read_int(compile_time);
   ccache_version = reader.read_str(reader.read_int<uint8_t>());
   namespace_ = reader.read_str(reader.read_int<uint8_t>());
   reader.read_int(entry_size);
@@ -188,6 +324,7 @@ CacheEntry::Header::serialize(util::Bytes& output) const
   writer.write_int(compression_level);
   writer.write_int<uint8_t>(self_contained);
   writer.write_int(creation_time);
+  writer.write_int(compile_time);
   writer.write_int(static_cast<uint8_t>(ccache_version.length()));
   writer.write_str(ccache_version);
   writer.write_int(static_cast<uint8_t>(namespace_.length()));
@@ -228,6 +365,12 @@ CacheEntry::CacheEntry(std::span<const uint8_t> data)
     break;
 
   case CompressionType::zstd:
+    if (decompress_frames_in_parallel(
+          parse_frame_table(m_payload, m_header.uncompressed_payload_size()),
+          m_uncompressed_payload,
+          m_header.uncompressed_payload_size())) {
+      break;
+    }
     m_uncompressed_payload.reserve(m_header.uncompressed_payload_size());
     util::throw_on_error<core::Error>(
       util::zstd_decompress(
@@ -273,23 +416,17 @@ util::Bytes
 CacheEntry::serialize(const CacheEntry::Header& header,
                       Serializer& payload_serializer)
 {
+  if (header.compression_type == CompressionType::zstd) {
+    util::Bytes payload;
+    payload_serializer.serialize(payload);
+    return serialize(header, payload);
+  }
+
   return do_serialize(
     header,
     payload_serializer.serialized_size(),
-    [&payload_serializer](util::Bytes& result, const CacheEntry::Header& hdr) {
-      switch (hdr.compression_type) {
-      case CompressionType::none:
-        payload_serializer.serialize(result);
-        break;
-
-      case CompressionType::zstd:
-        util::Bytes payload;
-        payload_serializer.serialize(payload);
-        util::throw_on_error<core::Error>(
-          util::zstd_compress(payload, result, hdr.compression_level),
-          "Cache entry payload compression error: ");
-        break;
-      }
+    [&payload_serializer](util::Bytes& result, const CacheEntry::Header&) {
+      payload_serializer.serialize(result);
     });
 }
 
@@ -297,8 +434,18 @@ util::Bytes
 CacheEntry::serialize(const CacheEntry::Header& header,
                       std::span<const uint8_t> payload)
 {
+  CacheEntry::Header final_header(header);
+  if (final_header.compression_type == CompressionType::zstd
+      && final_header.adaptive_compression_level) {
+    final_header.compression_level = util::zstd_adaptive_compression_level(
+      payload, final_header.write_bandwidth);
+    LOG("Using adaptive compression level {} for {} bytes",
+        final_header.compression_level,
+        payload.size());
+  }
+
   return do_serialize(
-    header,
+    final_header,
     payload.size(),
     [&payload](util::Bytes& result, const CacheEntry::Header& hdr) {
       switch (hdr.compression_type) {
@@ -307,9 +454,7 @@ CacheEntry::serialize(const CacheEntry::Header& header,
         break;
 
       case CompressionType::zstd:
-        util::throw_on_error<core::Error>(
-          util::zstd_compress(payload, result, hdr.compression_level),
-          "Cache entry payload compression error: ");
+        compress_payload(hdr, payload, result);
         break;
       }
     });
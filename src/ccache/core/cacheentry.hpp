@@ -35,8 +35,8 @@
 //
 // <entry>            ::= <header> <payload> <epilogue>
 // <header>           ::= <magic> <format_ver> <entry_type> <compr_type>
-//                        <compr_level> <creation_time> <ccache_ver> <namespace>
-//                        <entry_size>
+//                        <compr_level> <creation_time> <compile_time>
+//                        <ccache_ver> <namespace> <entry_size>
 // <magic>            ::= uint16_t (0xccac)
 // <format_ver>       ::= uint8_t
 // <entry_type>       ::= <result_entry> | <manifest_entry>
@@ -48,6 +48,8 @@
 // <compr_zstd>       ::= 1 (uint8_t)
 // <compr_level>      ::= int8_t
 // <creation_time>    ::= uint64_t (Unix epoch time when entry was created)
+// <compile_time>     ::= uint32_t ; milliseconds spent by the compiler creating
+//                        the entry, 0 if unknown
 // <ccache_ver>       ::= string length (uint8_t) + string data
 // <namespace>        ::= string length (uint8_t) + string data
 // <entry_size>       ::= uint64_t ; = size of entry in uncompressed form
@@ -55,6 +57,21 @@
 // <epilogue>         ::= <checksum_high> <checksum_low>
 // <checksum_high>    ::= uint64_t ; XXH3-128 (high bits) of <header>+<payload>
 // <checksum_low>     ::= uint64_t ; XXH3-128 (low bits) of <header>+<payload>
+//
+// A zstd-compressed payload of a result entry with at least two large files
+// (512 KiB or more) consists of one independently compressed frame per file
+// entry (see result::split_file_entries), preceded by a skippable frame with a
+// frame table, so that the frames can be located and decompressed in parallel.
+// Since decompressors ignore skippable frames, the payload is still a valid
+// Zstandard stream.
+//
+// <frame_table>      ::= <table_magic> <table_size> <n_frames> <frame_info>*
+// <table_magic>      ::= uint32_t (0x184d2a5c, little-endian)
+// <table_size>       ::= uint32_t (little-endian) ; size of the following data
+// <n_frames>         ::= uint16_t
+// <frame_info>       ::= <compressed_size> <uncompressed_size>
+// <compressed_size>  ::= uint64_t
+// <uncompressed_size>::= uint64_t
 
 class Config;
 
@@ -84,10 +101,20 @@ public:
     int8_t compression_level;
     bool self_contained;
     uint64_t creation_time;
+    uint32_t compile_time;
     std::string ccache_version;
     std::string namespace_;
     uint64_t entry_size;
 
+    // The following fields are not serialized.
+
+    // Whether to choose compression level per entry when serializing, see
+    // util::zstd_adaptive_compression_level.
+    bool adaptive_compression_level = false;
+    // Estimated bandwidth (bytes per second) of the storage that the entry will
+    // be written to, or 0 if unknown.
+    double write_bandwidth = 0;
+
     size_t serialized_size() const;
     void serialize(util::Bytes& output) const;
     uint64_t uncompressed_payload_size() const;
@@ -50,6 +50,9 @@ public:
   // Read an integer into `value`. Throws `core::Error` on failure.
   template<typename T> void read_int(T& value);
 
+  // Return whether all data has been read.
+  bool empty() const;
+
 private:
   std::span<const uint8_t> m_data;
 };
@@ -59,6 +62,12 @@ inline CacheEntryDataReader::CacheEntryDataReader(std::span<const uint8_t> data)
 {
 }
 
+inline bool
+CacheEntryDataReader::empty() const
+{
+  return m_data.empty();
+}
+
 inline std::span<const uint8_t>
 CacheEntryDataReader::read_bytes(size_t size)
 {
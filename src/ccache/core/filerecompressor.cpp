@@ -34,6 +34,17 @@ DirEntry
 FileRecompressor::recompress(const DirEntry& dir_entry,
                              std::optional<int8_t> level,
                              KeepAtime keep_atime)
+{
+  core::CacheEntry::Header header(dir_entry.path());
+  return *recompress(dir_entry, header, level, keep_atime);
+}
+
+std::optional<DirEntry>
+FileRecompressor::recompress(const DirEntry& dir_entry,
+                             core::CacheEntry::Header& header,
+                             std::optional<int8_t> level,
+                             KeepAtime keep_atime,
+                             util::LockFile* commit_lock)
 {
   std::optional<DirEntry> new_dir_entry;
 
@@ -52,11 +63,7 @@ FileRecompressor::recompress(const DirEntry& dir_entry,
   };
   DEFER(restore_timestamps());
 
-  core::CacheEntry::Header header(dir_entry.path());
-
-  const int8_t wanted_level =
-    level ? (*level == 0 ? core::CacheEntry::default_compression_level : *level)
-          : 0;
+  const int8_t wanted_level = wanted_compression_level(level);
 
   if (header.compression_level != wanted_level) {
     const auto cache_file_data = util::value_or_throw<core::Error>(
@@ -73,7 +80,21 @@ FileRecompressor::recompress(const DirEntry& dir_entry,
     AtomicFile new_cache_file(dir_entry.path(), AtomicFile::Mode::binary);
     new_cache_file.write(
       core::CacheEntry::serialize(header, cache_entry.payload()));
-    new_cache_file.commit();
+    if (commit_lock) {
+      if (!commit_lock->acquire()) {
+        throw core::Error(
+          FMT("Failed to acquire lock for {}", dir_entry.path()));
+      }
+      DEFER(commit_lock->release());
+      // The file may have been removed by a concurrent cleanup, and possibly
+      // stored again, after it was read.
+      if (!DirEntry(dir_entry.path()).same_inode_as(dir_entry)) {
+        return std::nullopt;
+      }
+      new_cache_file.commit();
+    } else {
+      new_cache_file.commit();
+    }
     new_dir_entry = DirEntry(dir_entry.path(), DirEntry::LogOnError::yes);
   }
 
@@ -84,6 +105,14 @@ FileRecompressor::recompress(const DirEntry& dir_entry,
   return new_dir_entry.value_or(dir_entry);
 }
 
+int8_t
+FileRecompressor::wanted_compression_level(std::optional<int8_t> level)
+{
+  return level ? (*level == 0 ? core::CacheEntry::default_compression_level
+                              : *level)
+               : 0;
+}
+
 uint64_t
 FileRecompressor::content_size() const
 {
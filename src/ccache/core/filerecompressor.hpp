@@ -18,7 +18,9 @@
 
 #pragma once
 
+#include <ccache/core/cacheentry.hpp>
 #include <ccache/util/direntry.hpp>
+#include <ccache/util/lockfile.hpp>
 
 #include <atomic>
 #include <cstdint>
@@ -38,6 +40,21 @@ public:
                             std::optional<int8_t> level,
                             KeepAtime keep_atime);
 
+  // Like above but with the header of `dir_entry` already known so that the
+  // file is only read if it needs to be recompressed. `header` is updated to
+  // the header of the recompressed file. If `commit_lock` is given, it is held
+  // while replacing the file, and std::nullopt is returned if the file has been
+  // removed or replaced since `dir_entry` was read.
+  std::optional<util::DirEntry>
+  recompress(const util::DirEntry& dir_entry,
+             CacheEntry::Header& header,
+             std::optional<int8_t> level,
+             KeepAtime keep_atime,
+             util::LockFile* commit_lock = nullptr);
+
+  // Return the compression level that `level` results in.
+  static int8_t wanted_compression_level(std::optional<int8_t> level);
+
   uint64_t content_size() const;
   uint64_t old_size() const;
   uint64_t new_size() const;
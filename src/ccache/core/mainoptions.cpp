@@ -18,6 +18,7 @@
 
 #include "mainoptions.hpp"
 
+#include <ccache/buildsession.hpp>
 #include <ccache/ccache.hpp>
 #include <ccache/config.hpp>
 #include <ccache/core/cacheentry.hpp>
@@ -35,6 +36,7 @@
 #include <ccache/storage/local/localstorage.hpp>
 #include <ccache/storage/storage.hpp>
 #include <ccache/util/assertions.hpp>
+#include <ccache/util/conversion.hpp>
 #include <ccache/util/cpu.hpp>
 #include <ccache/util/environment.hpp>
 #include <ccache/util/expected.hpp>
@@ -58,7 +60,10 @@
 #include <atomic>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <tuple>
+#include <unordered_set>
 #include <vector>
 
 #ifdef HAVE_UNISTD_H
@@ -105,6 +110,8 @@ constexpr const char USAGE_TEXT[] =
     In the third form, ccache is masquerading as the compiler.
 
 Common options:
+        --begin-build          start a build session in which concurrent ccache
+                               invocations share file hashes
     -c, --cleanup              delete not recently used files and recalculate
                                size counters (normally not needed as this is
                                done automatically)
@@ -114,17 +121,25 @@ Common options:
     -d, --dir PATH             operate on cache directory PATH instead of the
                                default
         --dry-run              do not perform any write operations
+        --end-build            end the build session started by --begin-build
         --evict-namespace NAMESPACE
                                remove files created in namespace NAMESPACE
         --evict-older-than AGE remove files used less recently than AGE
                                (unsigned integer with a d (days) or s (seconds)
                                suffix)
+        --io-limit SIZE        limit the data processed per second by
+                               --evict-* and --recompress to SIZE, e.g. 50MB
+                               (use 0 for no limit); available suffixes and
+                               default suffix as for --max-size
     -F, --max-files NUM        set maximum number of files in cache to NUM (use
                                0 for no limit)
     -M, --max-size SIZE        set maximum size of cache to SIZE (use 0 for no
                                limit); available suffixes: kB, MB, GB, TB
                                (decimal) and KiB, MiB, GiB, TiB (binary);
                                default suffix: GiB
+        --prefetch PATH        download cache entries whose keys are listed in
+                               PATH (a key per line or a ccache log file) from
+                               remote storage into the local cache
     -X, --recompress LEVEL     recompress the cache to level LEVEL (integer or
                                "uncompressed")
     -o, --set-config KEY=VALUE set configuration option KEY to value VALUE in the
@@ -204,6 +219,35 @@ read_from_path_or_stdin(const fs::path& path)
   }
 }
 
+// Extract manifest and result keys from `data`, which is either a list of keys
+// (one per line) or a ccache log file. Duplicates are removed.
+static std::vector<Hash::Digest>
+parse_prefetch_keys(std::string_view data)
+{
+  std::vector<Hash::Digest> keys;
+  std::unordered_set<std::string> seen_keys;
+  for (auto line : util::split_into_views(data, "\n")) {
+    for (const auto prefix : {"Manifest key: ", "Result key: "}) {
+      const auto pos = line.find(prefix);
+      if (pos != std::string_view::npos) {
+        line = line.substr(pos + std::string_view(prefix).length());
+        break;
+      }
+    }
+    const auto bytes =
+      util::parse_base16(std::string(util::strip_whitespace(line)));
+    if (!bytes || bytes->size() != std::tuple_size_v<Hash::Digest>) {
+      continue;
+    }
+    Hash::Digest key;
+    std::copy(bytes->begin(), bytes->end(), key.begin());
+    if (seen_keys.emplace(bytes->begin(), bytes->end()).second) {
+      keys.push_back(key);
+    }
+  }
+  return keys;
+}
+
 static int
 inspect_path(const fs::path& path)
 {
@@ -443,15 +487,19 @@ get_usage_text(const std::string_view ccache_name)
 }
 
 enum : uint8_t {
+  BEGIN_BUILD,
   CHECKSUM_FILE,
   CONFIG_PATH,
   DRY_RUN,
+  END_BUILD,
   EVICT_NAMESPACE,
   EVICT_OLDER_THAN,
   EXTRACT_RESULT,
   FORMAT,
   HASH_FILE,
   INSPECT,
+  IO_LIMIT,
+  PREFETCH,
   PRINT_LOG_STATS,
   PRINT_STATS,
   PRINT_VERSION,
@@ -469,6 +517,7 @@ enum : uint8_t {
 
 const char options_string[] = "cCd:k:hF:M:po:svVxX:z";
 const option long_options[] = {
+  {"begin-build",             NO_ARGUMENT, nullptr, BEGIN_BUILD         },
   {"checksum-file",           REQUIRED,    nullptr, CHECKSUM_FILE       },
   {"cleanup",                 NO_ARGUMENT, nullptr, 'c'                 },
   {"clear",                   NO_ARGUMENT, nullptr, 'C'                 },
@@ -478,6 +527,7 @@ const option long_options[] = {
   {"dry-run",                 NO_ARGUMENT, nullptr, DRY_RUN             },
   {"dump-manifest",           REQUIRED,    nullptr, INSPECT             }, // compat
   {"dump-result",             REQUIRED,    nullptr, INSPECT             }, // compat
+  {"end-build",               NO_ARGUMENT, nullptr, END_BUILD           },
   {"evict-namespace",         REQUIRED,    nullptr, EVICT_NAMESPACE     },
   {"evict-older-than",        REQUIRED,    nullptr, EVICT_OLDER_THAN    },
   {"extract-result",          REQUIRED,    nullptr, EXTRACT_RESULT      },
@@ -486,8 +536,10 @@ const option long_options[] = {
   {"hash-file",               REQUIRED,    nullptr, HASH_FILE           },
   {"help",                    NO_ARGUMENT, nullptr, 'h'                 },
   {"inspect",                 REQUIRED,    nullptr, INSPECT             },
+  {"io-limit",                REQUIRED,    nullptr, IO_LIMIT            },
   {"max-files",               REQUIRED,    nullptr, 'F'                 },
   {"max-size",                REQUIRED,    nullptr, 'M'                 },
+  {"prefetch",                REQUIRED,    nullptr, PREFETCH            },
   {"print-log-stats",         NO_ARGUMENT, nullptr, PRINT_LOG_STATS     },
   {"print-stats",             NO_ARGUMENT, nullptr, PRINT_STATS         },
   {"print-version",           NO_ARGUMENT, nullptr, PRINT_VERSION       },
@@ -528,6 +580,7 @@ process_main_options(int argc, const char* const* argv)
 
   std::optional<std::string> evict_namespace;
   std::optional<uint64_t> evict_max_age;
+  uint64_t io_limit = 0;
 
   // First pass: Handle non-command options that affect command options.
   while ((c = getopt_long(argc,
@@ -560,6 +613,10 @@ process_main_options(int argc, const char* const* argv)
       util::setenv("CCACHE_CONFIGPATH", arg);
       break;
 
+    case IO_LIMIT:
+      io_limit = util::value_or_throw<Error>(util::parse_size(arg)).first;
+      break;
+
     case THREADS:
       threads =
         static_cast<uint32_t>(util::value_or_throw<Error>(util::parse_unsigned(
@@ -612,6 +669,7 @@ process_main_options(int argc, const char* const* argv)
     case 'd': // --dir
     case DRY_RUN:
     case FORMAT:
+    case IO_LIMIT:
     case THREADS:
     case TRIM_MAX_SIZE:
     case TRIM_METHOD:
@@ -620,6 +678,28 @@ process_main_options(int argc, const char* const* argv)
       // Already handled in the first pass.
       break;
 
+    case BEGIN_BUILD:
+    case END_BUILD: {
+      if (dry_run == DryRun::yes) {
+        PRINT(stderr,
+              "--dry-run cannot be used with --{}\n",
+              c == BEGIN_BUILD ? "begin-build" : "end-build");
+        return EXIT_FAILURE;
+      }
+#ifdef INODE_CACHE_SUPPORTED
+      if (c == BEGIN_BUILD) {
+        if (const auto result = BuildSession::begin(config); !result) {
+          throw Fatal(result.error());
+        }
+      } else {
+        util::value_or_throw<Fatal>(BuildSession::end(config));
+      }
+#else
+      throw Fatal("Build sessions are not supported on this platform");
+#endif
+      break;
+    }
+
     case CHECKSUM_FILE: {
       util::XXH3_128 checksum;
       util::Fd fd(arg == "-" ? STDIN_FILENO : open(arg.c_str(), O_RDONLY));
@@ -696,6 +776,36 @@ process_main_options(int argc, const char* const* argv)
     case INSPECT:
       return inspect_path(arg);
 
+    case PREFETCH: {
+      if (dry_run == DryRun::yes) {
+        PRINT(stderr, "--dry-run cannot be used with --prefetch\n");
+        return EXIT_FAILURE;
+      }
+      if (config.remote_storage().empty()) {
+        throw Fatal("No remote storage has been configured");
+      }
+      if (config.remote_only()) {
+        throw Fatal("--prefetch cannot be used with remote_only");
+      }
+      const auto data = read_from_path_or_stdin(arg);
+      if (!data) {
+        PRINT(stderr, "Error: {}\n", data.error());
+        return EXIT_FAILURE;
+      }
+      const auto keys = parse_prefetch_keys(util::to_string_view(*data));
+
+      storage::Storage storage(config, fs::path(argv[0]).parent_path());
+      ProgressBar progress_bar("Prefetching...");
+      const auto fetched = storage.fetch_into_local_storage(
+        keys, threads, [&](double progress) { progress_bar.update(progress); });
+      storage.finalize();
+      if (isatty(STDOUT_FILENO)) {
+        PRINT(stdout, "\n");
+      }
+      PRINT(stdout, "Fetched {} of {} cache entries\n", fetched, keys.size());
+      break;
+    }
+
     case PRINT_STATS: {
       const auto [counters, last_updated] =
         storage::local::LocalStorage(config).get_all_statistics();
@@ -895,9 +1005,10 @@ process_main_options(int argc, const char* const* argv)
 
       ProgressBar progress_bar("Recompressing...");
       storage::local::LocalStorage(config).recompress(
-        wanted_level, threads, [&](double progress) {
-          progress_bar.update(progress);
-        });
+        wanted_level,
+        threads,
+        [&](double progress) { progress_bar.update(progress); },
+        io_limit);
       break;
     }
 
@@ -925,7 +1036,8 @@ process_main_options(int argc, const char* const* argv)
       dry_run,
       [&](double progress) { progress_bar.update(progress); },
       evict_max_age,
-      evict_namespace);
+      evict_namespace,
+      io_limit);
   }
 
   return EXIT_SUCCESS;
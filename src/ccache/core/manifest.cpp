@@ -24,56 +24,74 @@
 #include <ccache/core/exceptions.hpp>
 #include <ccache/hash.hpp>
 #include <ccache/hashutil.hpp>
+#include <ccache/util/conversion.hpp>
 #include <ccache/util/format.hpp>
 #include <ccache/util/logging.hpp>
 #include <ccache/util/string.hpp>
-#include <ccache/util/xxh3_64.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 // Manifest data format
 // ====================
 //
-// Integers are big-endian.
+// Integers are big-endian. All entries except paths have a fixed size, so the
+// position of any entry can be calculated from the counts in the header
+// without parsing the preceding entries.
 //
-// <payload>       ::= <format_ver> <paths> <includes> <results>
-// <format_ver>    ::= uint8_t
-// <paths>         ::= <n_paths> <path_entry>*
-// <n_paths>       ::= uint32_t
-// <path_entry>    ::= <path_len> <path>
-// <path_len>      ::= uint16_t
-// <path>          ::= path_len bytes
-// <includes>      ::= <n_includes> <include_entry>*
-// <n_includes>    ::= uint32_t
-// <include_entry> ::= <path_index> <digest> <fsize> <mtime> <ctime>
-// <path_index>    ::= uint32_t
-// <digest>        ::= Hash::Digest::size() bytes
-// <fsize>         ::= uint64_t ; file size
-// <mtime>         ::= int64_t ; modification time (ns), 0 = not recorded
-// <ctime>         ::= int64_t ; status change time (ns), 0 = not recorded
-// <results>       ::= <n_results> <result>*
-// <n_results>     ::= uint32_t
-// <result>        ::= <n_indexes> <include_index>* <key>
-// <n_indexes>     ::= uint32_t
-// <include_index> ::= uint32_t
-// <result_key>    ::= Hash::Digest::size() bytes
+// <payload>          ::= <format_ver> <n_paths> <n_includes> <n_results>
+//                        <n_indexes> <paths_size> <path_ends> <includes>
+//                        <results> <indexes> <paths>
+// <format_ver>       ::= uint8_t
+// <n_paths>          ::= uint32_t
+// <n_includes>       ::= uint32_t
+// <n_results>        ::= uint32_t
+// <n_indexes>        ::= uint32_t
+// <paths_size>       ::= uint32_t
+// <path_ends>        ::= <path_end>* ; n_paths entries
+// <path_end>         ::= uint32_t ; offset in <paths> where the path ends
+// <includes>         ::= <include_entry>* ; n_includes entries
+// <include_entry>    ::= <path_index> <digest> <fsize> <mtime> <ctime>
+// <path_index>       ::= uint32_t
+// <digest>           ::= Hash::Digest::size() bytes
+// <fsize>            ::= uint64_t ; file size
+// <mtime>            ::= int64_t ; modification time (ns), 0 = not recorded
+// <ctime>            ::= int64_t ; status change time (ns), 0 = not recorded
+// <results>          ::= <result>* ; n_results entries
+// <result>           ::= <first_index> <n_result_indexes> <result_key>
+// <first_index>      ::= uint32_t ; index of the result's first <include_index>
+// <n_result_indexes> ::= uint32_t
+// <result_key>       ::= Hash::Digest::size() bytes
+// <indexes>          ::= <include_index>* ; n_indexes entries
+// <include_index>    ::= uint32_t
+// <paths>            ::= paths_size bytes ; concatenated paths
 
 const uint32_t k_max_manifest_entries = 100;
 const uint32_t k_max_manifest_file_info_entries = 10000;
 
-namespace std {
+namespace {
+
+const size_t k_header_size = 1 + 5 * 4;
+const size_t k_path_end_size = 4;
+const size_t k_file_info_size =
+  4 + std::tuple_size<Hash::Digest>() + 8 + 8 + 8;
+const size_t k_result_size = 4 + 4 + std::tuple_size<Hash::Digest>();
+const size_t k_index_size = 4;
+
+const uint32_t k_no_index = std::numeric_limits<uint32_t>::max();
 
-template<> struct hash<core::Manifest::FileInfo>
+uint32_t
+read_uint32_at(const util::Bytes& data, size_t offset)
 {
-  size_t
-  operator()(const core::Manifest::FileInfo& file_info) const
-  {
-    static_assert(sizeof(file_info) == 48); // No padding.
-    util::XXH3_64 h;
-    h.update(&file_info, sizeof(file_info));
-    return h.digest();
-  }
-};
+  uint32_t value;
+  util::big_endian_to_int(data.data() + offset, value);
+  return value;
+}
 
-} // namespace std
+} // namespace
 
 namespace core {
 
@@ -83,15 +101,14 @@ namespace core {
 //   - First version.
 // Version 1:
 //   - mtime and ctime are now stored with nanoseconds resolution.
-const uint8_t Manifest::k_format_version = 1;
+// Version 2:
+//   - Fixed-size entries and a separate path table so that entries can be
+//     accessed directly in the serialized data.
+const uint8_t Manifest::k_format_version = 2;
 
 void
 Manifest::read(std::span<const uint8_t> data)
 {
-  std::vector<std::string> files;
-  std::vector<FileInfo> file_infos;
-  std::vector<ResultEntry> results;
-
   core::CacheEntryDataReader reader(data);
 
   const auto format_version = reader.read_int<uint8_t>();
@@ -101,81 +118,64 @@ Manifest::read(std::span<const uint8_t> data)
                           k_format_version));
   }
 
-  const auto file_count = reader.read_int<uint32_t>();
-  files.reserve(std::min(file_count, uint32_t{1024}));
-  for (uint32_t i = 0; i < file_count; ++i) {
-    files.emplace_back(reader.read_str(reader.read_int<uint16_t>()));
-  }
-
+  const auto path_count = reader.read_int<uint32_t>();
   const auto file_info_count = reader.read_int<uint32_t>();
-  for (uint32_t i = 0; i < file_info_count; ++i) {
-    file_infos.emplace_back();
-    auto& entry = file_infos.back();
-
-    reader.read_int(entry.index);
-    if (entry.index >= files.size()) {
-      throw core::Error(FMT("Corrupt manifest: file index {} >= files size {}",
-                            entry.index,
-                            files.size()));
-    }
-    reader.read_and_copy_bytes(entry.digest);
-    reader.read_int(entry.fsize);
-    entry.mtime =
-      util::TimePoint(std::chrono::nanoseconds(reader.read_int<int64_t>()));
-    entry.ctime =
-      util::TimePoint(std::chrono::nanoseconds(reader.read_int<int64_t>()));
+  const auto result_count = reader.read_int<uint32_t>();
+  const auto index_count = reader.read_int<uint32_t>();
+  const auto paths_size = reader.read_int<uint32_t>();
+
+  const uint64_t expected_size = k_header_size
+                                 + uint64_t{path_count} * k_path_end_size
+                                 + uint64_t{file_info_count} * k_file_info_size
+                                 + uint64_t{result_count} * k_result_size
+                                 + uint64_t{index_count} * k_index_size
+                                 + paths_size;
+  if (data.size() != expected_size) {
+    throw core::Error(FMT("Corrupt manifest: size {} != expected size {}",
+                          data.size(),
+                          expected_size));
   }
 
-  const auto result_count = reader.read_int<uint32_t>();
-  for (uint32_t i = 0; i < result_count; ++i) {
-    results.emplace_back();
-    auto& entry = results.back();
-
-    const auto file_info_index_count = reader.read_int<uint32_t>();
-    for (uint32_t j = 0; j < file_info_index_count; ++j) {
-      const auto file_info_index = reader.read_int<uint32_t>();
-      if (file_info_index >= file_infos.size()) {
-        throw core::Error(
-          FMT("Corrupt manifest: file info index {} >= file infos size {}",
-              file_info_index,
-              file_infos.size()));
-      }
-      entry.file_info_indexes.push_back(file_info_index);
-    }
-    reader.read_and_copy_bytes(entry.key);
+  Manifest manifest;
+  manifest.m_path_ends = reader.read_bytes(path_count * k_path_end_size);
+  manifest.m_file_infos = reader.read_bytes(file_info_count * k_file_info_size);
+  manifest.m_results = reader.read_bytes(result_count * k_result_size);
+  manifest.m_file_info_indexes = reader.read_bytes(index_count * k_index_size);
+  manifest.m_paths = reader.read_bytes(paths_size);
+  manifest.validate();
+
+  if (this->result_count() == 0) {
+    *this = std::move(manifest);
+    return;
   }
 
-  if (m_results.empty()) {
-    m_files = std::move(files);
-    m_file_infos = std::move(file_infos);
-    m_results = std::move(results);
-  } else {
-    for (const auto& result : results) {
-      std::unordered_map<std::string, Hash::Digest> included_files;
-      std::unordered_map<std::string, FileStats> included_files_stats;
-      for (auto file_info_index : result.file_info_indexes) {
-        const auto& file_info = file_infos[file_info_index];
-        included_files.emplace(files[file_info.index], file_info.digest);
-        included_files_stats.emplace(
-          files[file_info.index],
-          FileStats{file_info.fsize, file_info.mtime, file_info.ctime});
-      }
-      add_result(result.key, included_files, [&](const std::string& path) {
-        return included_files_stats[path];
-      });
+  for (uint32_t i = 0; i < manifest.result_count(); ++i) {
+    const auto result = manifest.result(i);
+    std::unordered_map<std::string, Hash::Digest> included_files;
+    std::unordered_map<std::string, FileStats> included_files_stats;
+    for (uint32_t j = 0; j < result.index_count; ++j) {
+      const auto file_info =
+        manifest.file_info(manifest.file_info_index(result.first_index + j));
+      std::string path(manifest.path(file_info.index));
+      included_files.emplace(path, file_info.digest);
+      included_files_stats.emplace(
+        path, FileStats{file_info.fsize, file_info.mtime, file_info.ctime});
     }
+    add_result(result.key, included_files, [&](const std::string& path) {
+      return included_files_stats[path];
+    });
   }
 }
 
 std::optional<Hash::Digest>
 Manifest::look_up_result_digest(Context& ctx) const
 {
-  std::unordered_map<std::string, FileStats> stated_files;
-  std::unordered_map<std::string, Hash::Digest> hashed_files;
+  std::unordered_map<std::string_view, FileStats> stated_files;
+  std::unordered_map<std::string_view, Hash::Digest> hashed_files;
 
   // Check newest result first since it's more likely to match.
-  for (size_t i = m_results.size(); i > 0; i--) {
-    const auto& result = m_results[i - 1];
+  for (uint32_t i = result_count(); i > 0; i--) {
+    const auto result = this->result(i - 1);
     LOG("Considering result entry {} ({})",
         i - 1,
         util::format_base16(result.key));
@@ -188,13 +188,22 @@ Manifest::look_up_result_digest(Context& ctx) const
   return std::nullopt;
 }
 
+std::optional<Hash::Digest>
+Manifest::newest_result_digest() const
+{
+  if (result_count() == 0) {
+    return std::nullopt;
+  }
+  return result(result_count() - 1).key;
+}
+
 bool
 Manifest::add_result(
   const Hash::Digest& result_key,
   const std::unordered_map<std::string, Hash::Digest>& included_files,
   const FileStater& stat_file_function)
 {
-  if (m_results.size() >= k_max_manifest_entries) {
+  if (result_count() >= k_max_manifest_entries) {
     // Normally, there shouldn't be many result entries in the manifest since
     // new entries are added only if an include file has changed but not the
     // source file, and you typically change source files more often than header
@@ -208,7 +217,7 @@ Manifest::add_result(
     LOG("Max limit ({}) of result entries in manifest file reached; discarding",
         k_max_manifest_entries);
     clear();
-  } else if (m_file_infos.size() >= k_max_manifest_file_info_entries) {
+  } else if (file_info_count() >= k_max_manifest_file_info_entries) {
     // Rarely, FileInfo entries can grow large in pathological cases where many
     // included files change, but the main file does not. This also puts an
     // upper bound on the number of FileInfo entries.
@@ -217,57 +226,120 @@ Manifest::add_result(
     clear();
   }
 
-  std::unordered_map<std::string, uint32_t /*index*/> mf_files;
-  for (uint32_t i = 0; i < m_files.size(); ++i) {
-    mf_files.emplace(m_files[i], i);
+  struct IncludedFile
+  {
+    std::string_view path;
+    uint32_t path_index = k_no_index;
+    std::array<uint8_t, k_file_info_size> file_info; // Serialized FileInfo.
+    uint32_t file_info_index = k_no_index;
+  };
+
+  std::vector<IncludedFile> files(included_files.size());
+  std::unordered_map<std::string_view, uint32_t /*index*/> files_by_path;
+  files_by_path.reserve(included_files.size());
+
+  size_t i = 0;
+  for (const auto& [path, digest] : included_files) {
+    auto& file = files[i];
+    file.path = path;
+    files_by_path.emplace(path, static_cast<uint32_t>(i));
+
+    const auto file_stat = stat_file_function(path);
+    util::Bytes file_info;
+    core::CacheEntryDataWriter writer(file_info);
+    writer.write_int(k_no_index); // Path index, filled in below.
+    writer.write_bytes(digest);
+    writer.write_int(file_stat.size);
+    writer.write_int(util::nsec_tot(file_stat.mtime));
+    writer.write_int(util::nsec_tot(file_stat.ctime));
+    memcpy(file.file_info.data(), file_info.data(), file.file_info.size());
+    ++i;
   }
 
-  std::unordered_map<FileInfo, uint32_t /*index*/> mf_file_infos;
-  for (uint32_t i = 0; i < m_file_infos.size(); ++i) {
-    mf_file_infos.emplace(m_file_infos[i], i);
+  // Only existing paths and file infos need to be matched against the included
+  // files since included_files doesn't contain duplicates.
+  const uint32_t old_path_count = path_count();
+  std::vector<uint32_t> files_by_path_index(old_path_count, k_no_index);
+  for (uint32_t j = 0; j < old_path_count; ++j) {
+    const auto it = files_by_path.find(path(j));
+    if (it != files_by_path.end()) {
+      files[it->second].path_index = j;
+      files_by_path_index[j] = it->second;
+    }
   }
 
-  std::vector<uint32_t> file_info_indexes;
-  file_info_indexes.reserve(included_files.size());
+  for (auto& file : files) {
+    if (file.path_index == k_no_index) {
+      file.path_index = path_count();
+      m_paths.insert(m_paths.end(), util::to_span(file.path));
+      core::CacheEntryDataWriter(m_path_ends)
+        .write_int(static_cast<uint32_t>(m_paths.size()));
+    }
+    util::int_to_big_endian(file.path_index, file.file_info.data());
+  }
 
-  for (const auto& [path, digest] : included_files) {
-    auto index = get_file_info_index(
-      path, digest, mf_files, mf_file_infos, stat_file_function);
-    if (!index) {
-      LOG("Index overflow in manifest");
-      return false;
+  for (uint32_t j = 0; j < file_info_count(); ++j) {
+    const uint8_t* file_info = m_file_infos.data() + j * k_file_info_size;
+    uint32_t path_index;
+    util::big_endian_to_int(file_info, path_index);
+    if (path_index >= old_path_count
+        || files_by_path_index[path_index] == k_no_index) {
+      continue;
+    }
+    auto& file = files[files_by_path_index[path_index]];
+    if (file.file_info_index == k_no_index
+        && memcmp(file_info, file.file_info.data(), k_file_info_size) == 0) {
+      file.file_info_index = j;
     }
-    file_info_indexes.push_back(*index);
   }
 
-  ResultEntry entry{std::move(file_info_indexes), result_key};
-  if (std::find(m_results.begin(), m_results.end(), entry) == m_results.end()) {
-    m_results.push_back(std::move(entry));
-    return true;
-  } else {
-    return false;
+  util::Bytes file_info_indexes;
+  core::CacheEntryDataWriter indexes_writer(file_info_indexes);
+  std::vector<uint32_t> sorted_indexes;
+  sorted_indexes.reserve(files.size());
+  for (auto& file : files) {
+    if (file.file_info_index == k_no_index) {
+      file.file_info_index = file_info_count();
+      m_file_infos.insert(m_file_infos.end(), file.file_info);
+    }
+    indexes_writer.write_int(file.file_info_index);
+    sorted_indexes.push_back(file.file_info_index);
+  }
+
+  // The order of the indexes depends on the iteration order of
+  // included_files, so compare them as sets.
+  std::sort(sorted_indexes.begin(), sorted_indexes.end());
+  std::vector<uint32_t> result_indexes;
+  for (uint32_t j = 0; j < result_count(); ++j) {
+    const auto result = this->result(j);
+    if (result.key != result_key || result.index_count != files.size()) {
+      continue;
+    }
+    result_indexes.clear();
+    for (uint32_t k = 0; k < result.index_count; ++k) {
+      result_indexes.push_back(file_info_index(result.first_index + k));
+    }
+    std::sort(result_indexes.begin(), result_indexes.end());
+    if (result_indexes == sorted_indexes) {
+      return false;
+    }
   }
+
+  core::CacheEntryDataWriter writer(m_results);
+  writer.write_int(
+    static_cast<uint32_t>(m_file_info_indexes.size() / k_index_size));
+  writer.write_int(static_cast<uint32_t>(files.size()));
+  writer.write_bytes(result_key);
+  m_file_info_indexes.insert(m_file_info_indexes.end(), file_info_indexes);
+  return true;
 }
 
 uint32_t
 Manifest::serialized_size() const
 {
-  uint64_t size = 0;
-
-  size += 1; // format_ver
-  size += 4; // n_files
-  for (const auto& file : m_files) {
-    size += 2 + file.length();
-  }
-  size += 4; // n_file_infos
-  size +=
-    m_file_infos.size() * (4 + std::tuple_size<Hash::Digest>() + 8 + 8 + 8);
-  size += 4; // n_results
-  for (const auto& result : m_results) {
-    size += 4; // n_file_info_indexes
-    size += result.file_info_indexes.size() * 4;
-    size += std::tuple_size<Hash::Digest>();
-  }
+  const uint64_t size = k_header_size + m_path_ends.size() + m_file_infos.size()
+                        + m_results.size() + m_file_info_indexes.size()
+                        + m_paths.size();
 
   // In order to support 32-bit ccache builds, restrict size to uint32_t for
   // now. This restriction can be lifted when we drop 32-bit support.
@@ -285,100 +357,147 @@ Manifest::serialize(util::Bytes& output)
   core::CacheEntryDataWriter writer(output);
 
   writer.write_int(k_format_version);
-  writer.write_int(static_cast<uint32_t>(m_files.size()));
-  for (const auto& file : m_files) {
-    writer.write_int(static_cast<uint16_t>(file.length()));
-    writer.write_str(file);
-  }
+  writer.write_int(path_count());
+  writer.write_int(file_info_count());
+  writer.write_int(result_count());
+  writer.write_int(
+    static_cast<uint32_t>(m_file_info_indexes.size() / k_index_size));
+  writer.write_int(static_cast<uint32_t>(m_paths.size()));
+  writer.write_bytes(m_path_ends);
+  writer.write_bytes(m_file_infos);
+  writer.write_bytes(m_results);
+  writer.write_bytes(m_file_info_indexes);
+  writer.write_bytes(m_paths);
+}
 
-  writer.write_int(static_cast<uint32_t>(m_file_infos.size()));
-  for (const auto& file_info : m_file_infos) {
-    writer.write_int<uint32_t>(file_info.index);
-    writer.write_bytes(file_info.digest);
-    writer.write_int(file_info.fsize);
-    writer.write_int(util::nsec_tot(file_info.mtime));
-    writer.write_int(util::nsec_tot(file_info.ctime));
-  }
+uint32_t
+Manifest::path_count() const
+{
+  return static_cast<uint32_t>(m_path_ends.size() / k_path_end_size);
+}
 
-  writer.write_int(static_cast<uint32_t>(m_results.size()));
-  for (const auto& result : m_results) {
-    writer.write_int(static_cast<uint32_t>(result.file_info_indexes.size()));
-    for (auto index : result.file_info_indexes) {
-      writer.write_int(index);
-    }
-    writer.write_bytes(result.key);
-  }
+uint32_t
+Manifest::file_info_count() const
+{
+  return static_cast<uint32_t>(m_file_infos.size() / k_file_info_size);
 }
 
-bool
-Manifest::FileInfo::operator==(const FileInfo& other) const
+uint32_t
+Manifest::result_count() const
 {
-  return index == other.index && digest == other.digest && fsize == other.fsize
-         && mtime == other.mtime && ctime == other.ctime;
+  return static_cast<uint32_t>(m_results.size() / k_result_size);
 }
 
-bool
-Manifest::ResultEntry::operator==(const ResultEntry& other) const
+std::string_view
+Manifest::path(uint32_t index) const
 {
-  return file_info_indexes == other.file_info_indexes && key == other.key;
+  const uint32_t begin =
+    index == 0 ? 0 : read_uint32_at(m_path_ends, (index - 1) * k_path_end_size);
+  const uint32_t end = read_uint32_at(m_path_ends, index * k_path_end_size);
+  return {reinterpret_cast<const char*>(m_paths.data()) + begin, end - begin};
 }
 
-void
-Manifest::clear()
+Manifest::FileInfo
+Manifest::file_info(uint32_t index) const
 {
-  m_files.clear();
-  m_file_infos.clear();
-  m_results.clear();
+  core::CacheEntryDataReader reader(
+    {m_file_infos.data() + index * k_file_info_size, k_file_info_size});
+  FileInfo file_info;
+  reader.read_int(file_info.index);
+  reader.read_and_copy_bytes(file_info.digest);
+  reader.read_int(file_info.fsize);
+  file_info.mtime =
+    util::TimePoint(std::chrono::nanoseconds(reader.read_int<int64_t>()));
+  file_info.ctime =
+    util::TimePoint(std::chrono::nanoseconds(reader.read_int<int64_t>()));
+  return file_info;
 }
 
-std::optional<uint32_t>
-Manifest::get_file_info_index(
-  const std::string& path,
-  const Hash::Digest& digest,
-  const std::unordered_map<std::string, uint32_t>& mf_files,
-  const std::unordered_map<FileInfo, uint32_t>& mf_file_infos,
-  const FileStater& file_stater)
+Manifest::ResultEntry
+Manifest::result(uint32_t index) const
 {
-  FileInfo fi;
+  core::CacheEntryDataReader reader(
+    {m_results.data() + index * k_result_size, k_result_size});
+  ResultEntry result;
+  reader.read_int(result.first_index);
+  reader.read_int(result.index_count);
+  reader.read_and_copy_bytes(result.key);
+  return result;
+}
 
-  const auto f_it = mf_files.find(path);
-  if (f_it != mf_files.end()) {
-    fi.index = f_it->second;
-  } else if (m_files.size() > UINT32_MAX) {
-    return std::nullopt;
-  } else {
-    m_files.push_back(path);
-    fi.index = static_cast<uint32_t>(m_files.size() - 1);
+uint32_t
+Manifest::file_info_index(uint32_t index) const
+{
+  return read_uint32_at(m_file_info_indexes, index * k_index_size);
+}
+
+void
+Manifest::validate() const
+{
+  uint32_t previous_end = 0;
+  for (uint32_t i = 0; i < path_count(); ++i) {
+    const uint32_t end = read_uint32_at(m_path_ends, i * k_path_end_size);
+    if (end < previous_end || end > m_paths.size()) {
+      throw core::Error(
+        FMT("Corrupt manifest: invalid end offset {} of path {}", end, i));
+    }
+    previous_end = end;
   }
 
-  fi.digest = digest;
+  for (uint32_t i = 0; i < file_info_count(); ++i) {
+    const uint32_t index = read_uint32_at(m_file_infos, i * k_file_info_size);
+    if (index >= path_count()) {
+      throw core::Error(FMT("Corrupt manifest: file index {} >= files size {}",
+                            index,
+                            path_count()));
+    }
+  }
 
-  const auto file_stat = file_stater(path);
-  fi.mtime = file_stat.mtime;
-  fi.ctime = file_stat.ctime;
-  fi.fsize = file_stat.size;
+  const auto index_count =
+    static_cast<uint32_t>(m_file_info_indexes.size() / k_index_size);
+  for (uint32_t i = 0; i < result_count(); ++i) {
+    const auto entry = result(i);
+    if (entry.first_index > index_count
+        || entry.index_count > index_count - entry.first_index) {
+      throw core::Error(
+        FMT("Corrupt manifest: file info indexes {}+{} >= indexes size {}",
+            entry.first_index,
+            entry.index_count,
+            index_count));
+    }
+  }
 
-  const auto fi_it = mf_file_infos.find(fi);
-  if (fi_it != mf_file_infos.end()) {
-    return fi_it->second;
-  } else if (m_file_infos.size() > UINT32_MAX) {
-    return std::nullopt;
-  } else {
-    m_file_infos.push_back(fi);
-    return m_file_infos.size() - 1;
+  for (uint32_t i = 0; i < index_count; ++i) {
+    const uint32_t index = file_info_index(i);
+    if (index >= file_info_count()) {
+      throw core::Error(
+        FMT("Corrupt manifest: file info index {} >= file infos size {}",
+            index,
+            file_info_count()));
+    }
   }
 }
 
+void
+Manifest::clear()
+{
+  m_path_ends.clear();
+  m_paths.clear();
+  m_file_infos.clear();
+  m_results.clear();
+  m_file_info_indexes.clear();
+}
+
 bool
 Manifest::result_matches(
   Context& ctx,
   const ResultEntry& result,
-  std::unordered_map<std::string, FileStats>& stated_files,
-  std::unordered_map<std::string, Hash::Digest>& hashed_files) const
+  std::unordered_map<std::string_view, FileStats>& stated_files,
+  std::unordered_map<std::string_view, Hash::Digest>& hashed_files) const
 {
-  for (uint32_t file_info_index : result.file_info_indexes) {
-    const auto& fi = m_file_infos[file_info_index];
-    const auto& path = m_files[fi.index];
+  for (uint32_t i = 0; i < result.index_count; ++i) {
+    const auto fi = file_info(file_info_index(result.first_index + i));
+    const auto path = this->path(fi.index);
 
     auto stated_files_iter = stated_files.find(path);
     if (stated_files_iter == stated_files.end()) {
@@ -463,45 +582,46 @@ Manifest::inspect(FILE* const stream) const
 {
   PRINT(stream, "Manifest format version: {}\n", k_format_version);
 
-  PRINT(stream, "File paths ({}):\n", m_files.size());
-  for (size_t i = 0; i < m_files.size(); ++i) {
-    PRINT(stream, "  {}: {}\n", i, m_files[i]);
+  PRINT(stream, "File paths ({}):\n", path_count());
+  for (uint32_t i = 0; i < path_count(); ++i) {
+    PRINT(stream, "  {}: {}\n", i, path(i));
   }
 
-  PRINT(stream, "File infos ({}):\n", m_file_infos.size());
-  for (size_t i = 0; i < m_file_infos.size(); ++i) {
+  PRINT(stream, "File infos ({}):\n", file_info_count());
+  for (uint32_t i = 0; i < file_info_count(); ++i) {
+    const auto fi = file_info(i);
     PRINT(stream, "  {}:\n", i);
-    PRINT(stream, "    Path index: {}\n", m_file_infos[i].index);
-    PRINT(
-      stream, "    Hash: {}\n", util::format_base16(m_file_infos[i].digest));
-    PRINT(stream, "    File size: {}\n", m_file_infos[i].fsize);
-    if (m_file_infos[i].mtime == util::TimePoint()) {
+    PRINT(stream, "    Path index: {}\n", fi.index);
+    PRINT(stream, "    Hash: {}\n", util::format_base16(fi.digest));
+    PRINT(stream, "    File size: {}\n", fi.fsize);
+    if (fi.mtime == util::TimePoint()) {
       PRINT(stream, "    Mtime: -\n");
     } else {
       PRINT(stream,
             "    Mtime: {}.{:09}\n",
-            util::sec(m_file_infos[i].mtime),
-            util::nsec_part(m_file_infos[i].mtime));
+            util::sec(fi.mtime),
+            util::nsec_part(fi.mtime));
     }
-    if (m_file_infos[i].ctime == util::TimePoint()) {
+    if (fi.ctime == util::TimePoint()) {
       PRINT(stream, "    Ctime: -\n");
     } else {
       PRINT(stream,
             "    Ctime: {}.{:09}\n",
-            util::sec(m_file_infos[i].ctime),
-            util::nsec_part(m_file_infos[i].ctime));
+            util::sec(fi.ctime),
+            util::nsec_part(fi.ctime));
     }
   }
 
-  PRINT(stream, "Results ({}):\n", m_results.size());
-  for (size_t i = 0; i < m_results.size(); ++i) {
+  PRINT(stream, "Results ({}):\n", result_count());
+  for (uint32_t i = 0; i < result_count(); ++i) {
+    const auto entry = result(i);
     PRINT(stream, "  {}:\n", i);
     PRINT(stream, "    File info indexes:");
-    for (uint32_t file_info_index : m_results[i].file_info_indexes) {
-      PRINT(stream, " {}", file_info_index);
+    for (uint32_t j = 0; j < entry.index_count; ++j) {
+      PRINT(stream, " {}", file_info_index(entry.first_index + j));
     }
     PRINT(stream, "\n");
-    PRINT(stream, "    Key: {}\n", util::format_base16(m_results[i].key));
+    PRINT(stream, "    Key: {}\n", util::format_base16(entry.key));
   }
 }
 
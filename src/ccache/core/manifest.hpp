@@ -29,6 +29,7 @@
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -56,6 +57,13 @@ public:
 
   std::optional<Hash::Digest> look_up_result_digest(Context& ctx) const;
 
+  // Return the key of the newest result entry, which is the one that
+  // look_up_result_digest considers first, or std::nullopt if there are no
+  // result entries.
+  std::optional<Hash::Digest> newest_result_digest() const;
+
+  uint32_t result_count() const;
+
   bool add_result(
     const Hash::Digest& result_key,
     const std::unordered_map<std::string, Hash::Digest>& included_files,
@@ -70,43 +78,46 @@ public:
 private:
   struct FileInfo
   {
-    uint32_t index;        // Index to m_files.
+    uint32_t index;        // Index to paths.
     Hash::Digest digest;   // Hash::Digest of referenced file.
     uint64_t fsize;        // Size of referenced file.
     util::TimePoint mtime; // mtime of referenced file.
     util::TimePoint ctime; // ctime of referenced file.
-
-    bool operator==(const FileInfo& other) const;
   };
 
-  friend std::hash<FileInfo>;
-
   struct ResultEntry
   {
-    std::vector<uint32_t> file_info_indexes; // Indexes to m_file_infos.
-    Hash::Digest key;                        // Key of the result.
-
-    bool operator==(const ResultEntry& other) const;
+    uint32_t first_index; // Index to m_file_info_indexes.
+    uint32_t index_count; // Number of file info indexes.
+    Hash::Digest key;     // Key of the result.
   };
 
-  std::vector<std::string> m_files;   // Names of referenced include files.
-  std::vector<FileInfo> m_file_infos; // Info about referenced include files.
-  std::vector<ResultEntry> m_results;
+  // The sections below are kept in serialized form so that entries can be
+  // looked up without deserializing the whole manifest and so that adding a
+  // result only appends to them.
+  util::Bytes m_path_ends;  // End offset in m_paths of each path.
+  util::Bytes m_paths;      // Names of referenced include files.
+  util::Bytes m_file_infos; // Info about referenced include files.
+  util::Bytes m_results;
+  util::Bytes m_file_info_indexes; // Indexes to m_file_infos.
 
-  void clear();
+  uint32_t path_count() const;
+  uint32_t file_info_count() const;
+
+  std::string_view path(uint32_t index) const;
+  FileInfo file_info(uint32_t index) const;
+  ResultEntry result(uint32_t index) const;
+  uint32_t file_info_index(uint32_t index) const;
 
-  std::optional<uint32_t> get_file_info_index(
-    const std::string& path,
-    const Hash::Digest& digest,
-    const std::unordered_map<std::string, uint32_t>& mf_files,
-    const std::unordered_map<FileInfo, uint32_t>& mf_file_infos,
-    const FileStater& file_state);
+  void validate() const;
+
+  void clear();
 
   bool result_matches(
     Context& ctx,
     const ResultEntry& result,
-    std::unordered_map<std::string, FileStats>& stated_files,
-    std::unordered_map<std::string, Hash::Digest>& hashed_files) const;
+    std::unordered_map<std::string_view, FileStats>& stated_files,
+    std::unordered_map<std::string_view, Hash::Digest>& hashed_files) const;
 };
 
 } // namespace core
@@ -182,6 +182,45 @@ gcno_file_in_unmangled_form(const Context& ctx)
   return util::with_extension(ctx.args_info.output_obj, ".gcno");
 }
 
+std::vector<std::span<const uint8_t>>
+split_file_entries(std::span<const uint8_t> data)
+{
+  // Offsets of the ends of the file entries.
+  std::vector<size_t> ends;
+  try {
+    CacheEntryDataReader reader(data);
+    if (reader.read_int<uint8_t>() != k_format_version) {
+      return {data};
+    }
+    const auto n_files = reader.read_int<uint8_t>();
+    size_t offset = 1 + 1; // format_ver + n_files
+    for (uint8_t i = 0; i < n_files; ++i) {
+      const auto marker = reader.read_int<uint8_t>();
+      reader.read_int<UnderlyingFileTypeInt>();
+      const auto file_size = reader.read_int<uint64_t>();
+      offset += 1 + 1 + 8; // marker + file_type + file_size
+      if (marker == k_embedded_file_marker) {
+        reader.read_bytes(file_size);
+        offset += file_size;
+      }
+      ends.push_back(offset);
+    }
+  } catch (const core::Error&) {
+    return {data};
+  }
+  if (ends.size() < 2 || ends.back() != data.size()) {
+    return {data};
+  }
+
+  std::vector<std::span<const uint8_t>> parts;
+  size_t start = 0;
+  for (const auto end : ends) {
+    parts.push_back(data.subspan(start, end - start));
+    start = end;
+  }
+  return parts;
+}
+
 Deserializer::Deserializer(std::span<const uint8_t> data)
   : m_data(data)
 {
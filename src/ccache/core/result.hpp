@@ -106,6 +106,12 @@ const char* file_type_to_string(FileType type);
 std::filesystem::path gcno_file_in_mangled_form(const Context& ctx);
 std::filesystem::path gcno_file_in_unmangled_form(const Context& ctx);
 
+// Split serialized result `data` into one part per file entry, where the first
+// part also includes the result header. Returns `data` as the only part if it
+// has fewer than two file entries or can't be parsed.
+std::vector<std::span<const uint8_t>>
+split_file_entries(std::span<const uint8_t> data);
+
 // This class knows how to deserializer a result cache entry.
 class Deserializer
 {
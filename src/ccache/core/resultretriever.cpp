@@ -23,6 +23,7 @@
 #include <ccache/core/common.hpp>
 #include <ccache/core/exceptions.hpp>
 #include <ccache/depfile.hpp>
+#include <ccache/util/conversion.hpp>
 #include <ccache/util/direntry.hpp>
 #include <ccache/util/expected.hpp>
 #include <ccache/util/fd.hpp>
@@ -42,6 +43,8 @@
 #  include <unistd.h>
 #endif
 
+#include <algorithm>
+
 namespace fs = util::filesystem;
 
 using util::DirEntry;
@@ -77,10 +80,18 @@ ResultRetriever::on_embedded_file(uint8_t file_number,
     core::send_to_console(m_ctx, util::to_string_view(data), STDERR_FILENO);
   } else {
     const auto dest_path = get_dest_path(file_type);
+    std::string dependency_file_content;
+    if (file_type == FileType::dependency && !dest_path.empty()) {
+      dependency_file_content = get_dependency_file_content(data);
+      data = util::to_span(dependency_file_content);
+    }
+
     if (dest_path.empty()) {
       LOG("Not writing");
     } else if (util::is_dev_null_path(dest_path)) {
       LOG("Not writing to {}", dest_path);
+    } else if (touch_if_unchanged(dest_path, data)) {
+      LOG("Not writing to unchanged {}", dest_path);
     } else {
       LOG("Writing to {}", dest_path);
       if (file_type == FileType::dependency) {
@@ -219,36 +230,63 @@ ResultRetriever::get_dest_path(FileType file_type) const
   return {};
 }
 
-void
-ResultRetriever::write_dependency_file(const fs::path& path,
-                                       std::span<const uint8_t> data)
+bool
+ResultRetriever::touch_if_unchanged(const fs::path& path,
+                                    std::span<const uint8_t> data) const
 {
-  ASSERT(m_ctx.args_info.dependency_target);
+  if (!m_ctx.config.skip_unchanged_outputs()) {
+    return false;
+  }
 
-  util::Fd fd(open(
-    util::pstr(path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666));
-  if (!fd) {
-    throw WriteError(FMT("Failed to open {} for writing", path));
+  DirEntry de(path);
+  if (!de.is_regular_file() || de.size() != data.size()) {
+    return false;
+  }
+  // The file is read in full. Looking up its digest in the inode cache would
+  // not help since touching it below invalidates the inode cache entry.
+  const auto content = util::read_file<util::Bytes>(path, data.size());
+  if (!content
+      || !std::equal(
+        content->begin(), content->end(), data.begin(), data.end())) {
+    return false;
   }
 
-  auto write_data = [&](auto d, auto s) {
-    util::throw_on_error<WriteError>(util::write_fd(*fd, d, s),
-                                     FMT("Failed to write to {}: ", path));
-  };
+  // Make the file look as if it had been written so that build systems
+  // consider it up to date.
+  util::set_timestamps(path);
+  return true;
+}
+
+std::string
+ResultRetriever::get_dependency_file_content(
+  std::span<const uint8_t> data) const
+{
+  ASSERT(m_ctx.args_info.dependency_target);
 
   std::string_view str_data = util::to_string_view(data);
-  size_t start_pos = 0;
   const size_t colon_pos = str_data.find(": ");
   if (colon_pos != std::string::npos) {
     const auto obj_in_dep_file = str_data.substr(0, colon_pos);
     const auto& dep_target = *m_ctx.args_info.dependency_target;
     if (obj_in_dep_file != dep_target) {
-      write_data(dep_target.data(), dep_target.length());
-      start_pos = colon_pos;
+      return FMT("{}{}", dep_target, str_data.substr(colon_pos));
     }
   }
+  return std::string(str_data);
+}
 
-  write_data(str_data.data() + start_pos, str_data.length() - start_pos);
+void
+ResultRetriever::write_dependency_file(const fs::path& path,
+                                       std::span<const uint8_t> data)
+{
+  util::Fd fd(open(
+    util::pstr(path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666));
+  if (!fd) {
+    throw WriteError(FMT("Failed to open {} for writing", path));
+  }
+  util::throw_on_error<WriteError>(
+    util::write_fd(*fd, data.data(), data.size()),
+    FMT("Failed to write to {}: ", path));
 }
 
 } // namespace core
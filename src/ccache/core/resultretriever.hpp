@@ -26,6 +26,7 @@
 #include <filesystem>
 #include <optional>
 #include <span>
+#include <string>
 
 class Context;
 
@@ -58,6 +59,15 @@ private:
 
   std::filesystem::path get_dest_path(result::FileType file_type) const;
 
+  // Return whether skip_unchanged_outputs is enabled and `path` already has the
+  // content `data`. If so, the timestamps of `path` are updated instead of
+  // rewriting it.
+  bool touch_if_unchanged(const std::filesystem::path& path,
+                          std::span<const uint8_t> data) const;
+
+  // Return `data` with the target replaced by the dependency target.
+  std::string get_dependency_file_content(std::span<const uint8_t> data) const;
+
   void write_dependency_file(const std::filesystem::path& path,
                              std::span<const uint8_t> data);
 };
@@ -82,8 +82,16 @@ enum class Statistic {
   bad_input_file = 82,
   modified_input_file = 83,
   unsupported_source_encoding = 84,
+  compression_input_byte = 85,
+  compression_output_byte = 86,
+  compression_microsecond = 87,
+  local_storage_write_byte = 88,
+  local_storage_write_microsecond = 89,
+  remote_storage_fill_skipped = 90,
+  compile_time_millisecond = 91,
+  compile_time_saved_millisecond = 92,
 
-  END = 85,
+  END = 93,
 };
 
 enum class StatisticsFormat {
@@ -36,6 +36,7 @@ const unsigned FLAG_NOZERO = 1U << 0;      // don't zero with --zero-stats
 const unsigned FLAG_NEVER = 1U << 1;       // don't include in --print-stats
 const unsigned FLAG_ERROR = 1U << 2;       // include in error count
 const unsigned FLAG_UNCACHEABLE = 1U << 3; // include in uncacheable count
+const unsigned FLAG_AMOUNT = 1U << 4;      // not an event count
 
 namespace {
 
@@ -104,6 +105,13 @@ const StatisticsField k_statistics_fields[] = {
   // The compilation failed. No result stored in the cache.
   FIELD(compile_failed, "Compilation failed", FLAG_UNCACHEABLE),
 
+  // Time spent running the compiler on cache misses in milliseconds.
+  FIELD(compile_time_millisecond, nullptr, FLAG_AMOUNT),
+
+  // Compile time saved by cache hits in milliseconds, i.e. the compile time
+  // recorded in the retrieved results minus the time spent by ccache.
+  FIELD(compile_time_saved_millisecond, nullptr, FLAG_AMOUNT),
+
   // A compiler check program specified by compiler_check/CCACHE_COMPILERCHECK
   // failed.
   FIELD(compiler_check_failed, "Compiler check failed", FLAG_ERROR),
@@ -124,6 +132,15 @@ const StatisticsField k_statistics_fields[] = {
   // caching stdout output as well.]
   FIELD(compiler_produced_stdout, "Compiler produced stdout", FLAG_UNCACHEABLE),
 
+  // Total size of cache entries before compression.
+  FIELD(compression_input_byte, nullptr, FLAG_AMOUNT),
+
+  // Total size of cache entries after compression.
+  FIELD(compression_output_byte, nullptr, FLAG_AMOUNT),
+
+  // Time spent compressing cache entries in microseconds.
+  FIELD(compression_microsecond, nullptr, FLAG_AMOUNT),
+
   // The compiler to execute could not be found.
   FIELD(could_not_find_compiler, "Could not find compiler", FLAG_ERROR),
 
@@ -171,6 +188,12 @@ const StatisticsField k_statistics_fields[] = {
   // An entry (manifest or result file) was written local storage.
   FIELD(local_storage_write, nullptr),
 
+  // Number of bytes written to local storage when storing entries.
+  FIELD(local_storage_write_byte, nullptr, FLAG_AMOUNT),
+
+  // Time spent writing entries to local storage in microseconds.
+  FIELD(local_storage_write_microsecond, nullptr, FLAG_AMOUNT),
+
   // A file was unexpectedly missing from the cache. This only happens in rare
   // situations, e.g. if one ccache instance is about to get a file from the
   // cache while another instance removed the file as part of cache cleanup.
@@ -214,6 +237,10 @@ const StatisticsField k_statistics_fields[] = {
   // Error when connecting to, reading from or writing to remote storage.
   FIELD(remote_storage_error, nullptr),
 
+  // An entry read from remote storage was not stored in local storage due to
+  // the remote_fill_policy option.
+  FIELD(remote_storage_fill_skipped, nullptr),
+
   // A cacheable call resulted in a hit when attempting to look up a result from
   // remote storage.
   FIELD(remote_storage_hit, nullptr),
@@ -286,6 +313,19 @@ format_timestamp(const util::TimePoint& value)
   }
 }
 
+static std::string
+format_milliseconds(const uint64_t milliseconds)
+{
+  const double seconds = static_cast<double>(milliseconds) / 1000;
+  if (seconds < 60) {
+    return FMT("{:.1f} s", seconds);
+  } else if (seconds < 3600) {
+    return FMT("{:.1f} min", seconds / 60);
+  } else {
+    return FMT("{:.1f} h", seconds / 3600);
+  }
+}
+
 static std::string
 percent(const uint64_t nominator, const uint64_t denominator)
 {
@@ -315,7 +355,7 @@ Statistics::get_statistics_ids() const
 {
   std::vector<std::string> result;
   for (const auto& field : k_statistics_fields) {
-    if (!(field.flags & FLAG_NOZERO)) {
+    if (!(field.flags & (FLAG_NOZERO | FLAG_AMOUNT))) {
       for (size_t i = 0; i < m_counters.get(field.statistic); ++i) {
         result.emplace_back(field.id);
       }
@@ -325,6 +365,20 @@ Statistics::get_statistics_ids() const
   return result;
 }
 
+std::vector<std::string>
+Statistics::get_statistics_amounts() const
+{
+  std::vector<std::string> result;
+  for (const auto& field : k_statistics_fields) {
+    const auto value = m_counters.get(field.statistic);
+    if ((field.flags & FLAG_AMOUNT) && !(field.flags & FLAG_NOZERO)
+        && value > 0) {
+      result.push_back(FMT("{} {}", field.id, value));
+    }
+  }
+  return result;
+}
+
 uint64_t
 Statistics::count_stats(const unsigned flags) const
 {
@@ -421,6 +475,17 @@ Statistics::format_human_readable(const Config& config,
     add_ratio_row(table, "  Misses:", misses, hits + misses);
   }
 
+  const uint64_t compile_time_saved = S(compile_time_saved_millisecond);
+  const uint64_t compile_time_spent = S(compile_time_millisecond);
+  if (compile_time_saved > 0 || verbosity > 1) {
+    table.add_row({"Compile time saved:",
+                   C(format_milliseconds(compile_time_saved)).right_align()});
+  }
+  if (verbosity > 1 || (verbosity > 0 && compile_time_spent > 0)) {
+    table.add_row({"Compile time spent:",
+                   C(format_milliseconds(compile_time_spent)).right_align()});
+  }
+
   if (uncacheable > 0 || verbosity > 1) {
     add_ratio_row(table, "Uncacheable calls:", uncacheable, total_calls);
     if (verbosity > 0) {
@@ -470,6 +535,7 @@ Statistics::format_human_readable(const Config& config,
   const uint64_t remote_writes = S(remote_storage_write);
   const uint64_t remote_errors = S(remote_storage_error);
   const uint64_t remote_timeouts = S(remote_storage_timeout);
+  const uint64_t remote_fills_skipped = S(remote_storage_fill_skipped);
 
   if (!from_log || verbosity > 0 || (local_hits + local_misses) > 0) {
     table.add_heading("Local storage:");
@@ -523,6 +589,9 @@ Statistics::format_human_readable(const Config& config,
       table.add_row({"  Reads:", remote_reads});
       table.add_row({"  Writes:", remote_writes});
     }
+    if (verbosity > 1 || remote_fills_skipped > 0) {
+      table.add_row({"  Not stored locally:", remote_fills_skipped});
+    }
     if (verbosity > 1 || remote_errors > 0) {
       table.add_row({"  Errors:", remote_errors});
     }
@@ -531,6 +600,34 @@ Statistics::format_human_readable(const Config& config,
     }
   }
 
+  const uint64_t compression_input = S(compression_input_byte);
+  const uint64_t compression_output = S(compression_output_byte);
+  if (verbosity > 0 && compression_input > 0) {
+    const uint64_t bytes_saved =
+      compression_input > compression_output
+        ? compression_input - compression_output
+        : 0;
+    table.add_heading("Compression:");
+    table.add_row({"  Bytes saved:",
+                   C(util::format_human_readable_size(
+                       bytes_saved, config.size_unit_prefix_type()))
+                     .right_align()});
+
+    // Time saved is the estimated time it would have taken to write the saved
+    // bytes to local storage minus the time spent compressing.
+    const uint64_t written = S(local_storage_write_byte);
+    const uint64_t write_time = S(local_storage_write_microsecond);
+    if (written > 0 && write_time > 0) {
+      const double time_saved =
+        (static_cast<double>(bytes_saved) * static_cast<double>(write_time)
+           / static_cast<double>(written)
+         - static_cast<double>(S(compression_microsecond)))
+        / 1'000'000;
+      table.add_row(
+        {"  Time saved:", C(FMT("{:.1f} s", time_saved)).right_align()});
+    }
+  }
+
   return table.render();
 }
 
@@ -40,6 +40,10 @@ public:
   // Return machine-readable strings representing the statistics counters.
   std::vector<std::string> get_statistics_ids() const;
 
+  // Return "<id> <value>" strings for nonzero amount counters, e.g. times and
+  // sizes.
+  std::vector<std::string> get_statistics_amounts() const;
+
   // Format cache statistics in human-readable format.
   std::string format_human_readable(const Config& config,
                                     const util::TimePoint& last_updated,
@@ -25,6 +25,7 @@
 #include <ccache/util/format.hpp>
 #include <ccache/util/logging.hpp>
 #include <ccache/util/path.hpp>
+#include <ccache/util/string.hpp>
 
 #include <cstring>
 #include <fstream>
@@ -46,12 +47,23 @@ StatsLog::read() const
     if (line[0] == '#') {
       continue;
     }
-    const auto entry = id_map.find(line);
+    // A line is either an ID of an event or an ID and an amount.
+    const auto [id, amount_str] = util::split_once_into_views(line, ' ');
+    int64_t amount = 1;
+    if (amount_str) {
+      const auto parsed = util::parse_signed(*amount_str);
+      if (!parsed) {
+        LOG("Invalid statistics line: {}", line);
+        continue;
+      }
+      amount = *parsed;
+    }
+    const auto entry = id_map.find(std::string(id));
     if (entry != id_map.end()) {
       Statistic statistic = entry->second;
-      counters.increment(statistic, 1);
+      counters.increment(statistic, amount);
     } else {
-      LOG("Unknown statistic: {}", line);
+      LOG("Unknown statistic: {}", id);
     }
   }
 
@@ -39,9 +39,12 @@
 #include <ccache/util/temporaryfile.hpp>
 #include <ccache/util/wincompat.hpp>
 
+#include <utility>
 #include <vector>
 
 #ifndef _WIN32
+#  include <fcntl.h>
+#  include <poll.h>
 #  include <spawn.h>
 #endif
 
@@ -281,6 +284,16 @@ execute(Context& ctx,
         const char* const* argv,
         util::Fd&& fd_out,
         util::Fd&& fd_err)
+{
+  return execute(ctx, argv, std::move(fd_out), std::move(fd_err), {});
+}
+
+int
+execute(Context& ctx,
+        const char* const* argv,
+        util::Fd&& fd_out,
+        util::Fd&& fd_err,
+        const std::function<void()>& while_running)
 {
   LOG("Executing {}", util::format_argv_for_logging(argv));
 
@@ -307,9 +320,14 @@ execute(Context& ctx,
 
   posix_spawnattr_t attr;
   CHECK_LIB_CALL(posix_spawnattr_init, &attr);
-  CHECK_LIB_CALL(posix_spawnattr_setflags,
-                 &attr,
-                 POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+  short spawn_flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_USEVFORK
+  // Avoid copying page tables with glibc < 2.24, which otherwise uses fork(2).
+  // Newer glibc versions always use clone(CLONE_VM | CLONE_VFORK) and ignore
+  // the flag.
+  spawn_flags |= POSIX_SPAWN_USEVFORK;
+#endif
+  CHECK_LIB_CALL(posix_spawnattr_setflags, &attr, spawn_flags);
 
   sigset_t sigmask;
   CHECK_LIB_CALL(sigemptyset, &sigmask);
@@ -342,6 +360,10 @@ execute(Context& ctx,
     return -1;
   }
 
+  if (while_running) {
+    while_running();
+  }
+
   int status;
   while (waitpid(ctx.compiler_pid, &status, 0) == -1) {
     if (errno != EINTR) {
@@ -361,6 +383,112 @@ execute(Context& ctx,
   return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 }
 
+tl::expected<int, std::string>
+execute_and_capture(Context& ctx,
+                    const char* const* argv,
+                    const util::DataReceiver& stdout_receiver,
+                    util::Bytes& stderr_data)
+{
+  const util::DataReceiver stderr_receiver = [&](auto data) {
+    stderr_data.insert(stderr_data.end(), data);
+  };
+
+  struct Capture
+  {
+    const util::DataReceiver* receiver;
+    util::Fd read_fd;
+    util::Fd write_fd;
+  };
+
+  Capture captures[] = {
+    {stdout_receiver ? &stdout_receiver : nullptr, {}, {}},
+    {&stderr_receiver,                             {}, {}},
+  };
+  for (auto& capture : captures) {
+    if (!capture.receiver) {
+      capture.write_fd = util::Fd(open(util::get_dev_null_path(), O_WRONLY));
+      continue;
+    }
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+      return tl::unexpected(FMT("Failed to create pipe: {}", strerror(errno)));
+    }
+    capture.read_fd = util::Fd(pipe_fds[0]);
+    capture.write_fd = util::Fd(pipe_fds[1]);
+    fcntl(*capture.read_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(*capture.read_fd, F_SETFL, O_NONBLOCK);
+  }
+
+  std::string error;
+  const int status = execute(
+    ctx,
+    argv,
+    std::move(captures[0].write_fd),
+    std::move(captures[1].write_fd),
+    [&] {
+      // Read from both pipes as data arrives so that the process doesn't block
+      // on a full pipe.
+      pollfd poll_fds[2];
+      for (size_t i = 0; i < 2; ++i) {
+        poll_fds[i].fd = captures[i].read_fd ? *captures[i].read_fd : -1;
+        poll_fds[i].events = POLLIN;
+      }
+      uint8_t buffer[CCACHE_READ_BUFFER_SIZE];
+      bool process_exited = false;
+      while (poll_fds[0].fd != -1 || poll_fds[1].fd != -1) {
+        const int ready = poll(poll_fds, 2, process_exited ? 0 : 100);
+        if (ready == -1) {
+          if (errno == EINTR) {
+            continue;
+          }
+          error = FMT("poll failed: {}", strerror(errno));
+          break;
+        }
+        if (ready == 0) {
+          if (process_exited) {
+            // A descendant of the process (e.g. a compiler server) keeps the
+            // pipes open; don't wait for it.
+            break;
+          }
+          siginfo_t info{};
+          process_exited = waitid(P_PID,
+                                  ctx.compiler_pid,
+                                  &info,
+                                  WEXITED | WNOHANG | WNOWAIT)
+                             == 0
+                           && info.si_pid != 0;
+          continue;
+        }
+        for (size_t i = 0; i < 2; ++i) {
+          if (poll_fds[i].fd == -1 || poll_fds[i].revents == 0) {
+            continue;
+          }
+          const auto n = read(poll_fds[i].fd, buffer, sizeof(buffer));
+          if (n > 0) {
+            (*captures[i].receiver)({buffer, static_cast<size_t>(n)});
+          } else if (n == 0
+                     || (errno != EINTR && errno != EAGAIN
+                         && errno != EWOULDBLOCK)) {
+            if (n == -1) {
+              error = FMT("Failed to read from pipe: {}", strerror(errno));
+            }
+            poll_fds[i].fd = -1;
+          }
+        }
+      }
+      // Close the pipes now so that the process doesn't block on writing to
+      // them in case of an error above.
+      for (auto& capture : captures) {
+        capture.read_fd.close();
+      }
+    });
+
+  if (!error.empty()) {
+    return tl::unexpected(error);
+  }
+  return status;
+}
+
 void
 execute_noreturn(const char* const* argv, const fs::path& /*temp_dir*/)
 {
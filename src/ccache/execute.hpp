@@ -18,7 +18,11 @@
 
 #pragma once
 
+#include <ccache/util/bytes.hpp>
 #include <ccache/util/fd.hpp>
+#include <ccache/util/types.hpp>
+
+#include <tl/expected.hpp>
 
 #include <filesystem>
 #include <functional>
@@ -34,6 +38,26 @@ int execute(Context& ctx,
             util::Fd&& fd_out,
             util::Fd&& fd_err);
 
+#ifndef _WIN32
+// Like above but call `while_running` after the process has been started and
+// before waiting for it to exit, e.g. to consume output written to a pipe.
+int execute(Context& ctx,
+            const char* const* argv,
+            util::Fd&& fd_out,
+            util::Fd&& fd_err,
+            const std::function<void()>& while_running);
+
+// Execute a compiler backend, capturing output via pipes instead of temporary
+// files. Standard output is passed to `stdout_receiver` as it arrives (or
+// discarded if `stdout_receiver` is empty) and standard error is stored in
+// `stderr_data`. Returns the exit status or an error message.
+tl::expected<int, std::string>
+execute_and_capture(Context& ctx,
+                    const char* const* argv,
+                    const util::DataReceiver& stdout_receiver,
+                    util::Bytes& stderr_data);
+#endif
+
 void execute_noreturn(const char* const* argv,
                       const std::filesystem::path& temp_dir);
 
@@ -217,10 +217,15 @@ do_hash_file(const Context& ctx,
       ? InodeCache::ContentType::checked_for_temporal_macros_and_directives
       : InodeCache::ContentType::raw;
 
+  if (auto result = ctx.build_session.get(path, content_type)) {
+    digest = result->second;
+    return result->first;
+  }
   if (ctx.config.inode_cache()) {
     const auto result = ctx.inode_cache.get(path, content_type);
     if (result) {
       digest = result->second;
+      ctx.build_session.put(path, content_type, digest, result->first);
       return result->first;
     }
   }
@@ -244,6 +249,7 @@ do_hash_file(const Context& ctx,
     result = check_for_source_code_patterns(str);
   }
 #ifdef INODE_CACHE_SUPPORTED
+  ctx.build_session.put(path, content_type, digest, result);
   ctx.inode_cache.put(path, content_type, digest, result);
 #endif
 
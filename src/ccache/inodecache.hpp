@@ -50,6 +50,9 @@ public:
     // The file was checked for temporal macros as well as embed and incbin
     // directives.
     checked_for_temporal_macros_and_directives = 2,
+    // The file is preprocessed input that was hashed by
+    // process_preprocessed_file in ccache.cpp. Only found_incbin is recorded.
+    preprocessed = 3,
   };
 
   // `min_age` specifies how old a file must be to be put in the cache. The
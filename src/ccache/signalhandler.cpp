@@ -20,6 +20,7 @@
 
 #include <ccache/context.hpp>
 #include <ccache/util/assertions.hpp>
+#include <ccache/util/logging.hpp>
 
 #include <signal.h> // NOLINT: sigaddset et al are defined in signal.h
 #include <sys/types.h>
@@ -117,6 +118,9 @@ SignalHandler::on_signal(int signum)
     waitpid(ctx.compiler_pid, nullptr, 0);
   }
 
+  // Exit handlers won't run, so write buffered log lines now.
+  util::logging::flush_signal_safe();
+
   // Resend signal to ourselves to exit properly after returning from the
   // handler.
   kill(getpid(), signum);
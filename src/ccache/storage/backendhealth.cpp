@@ -0,0 +1,184 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "backendhealth.hpp"
+
+#include <ccache/core/atomicfile.hpp>
+#include <ccache/core/exceptions.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/filesystem.hpp>
+#include <ccache/util/format.hpp>
+#include <ccache/util/lockfile.hpp>
+#include <ccache/util/logging.hpp>
+#include <ccache/util/string.hpp>
+#include <ccache/util/xxh3_64.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace fs = util::filesystem;
+
+using namespace std::chrono_literals;
+
+// File format: "<consecutive failures> <time of last attempt in nanoseconds>".
+
+namespace {
+
+const std::chrono::nanoseconds k_initial_backoff = 1s;
+const std::chrono::nanoseconds k_max_backoff = 1min;
+
+} // namespace
+
+namespace storage {
+
+BackendHealth::BackendHealth(const fs::path& dir, std::string_view url)
+{
+  util::XXH3_64 hash;
+  hash.update(url.data(), url.length());
+  m_path = dir / FMT("remote-health-{:016x}", hash.digest());
+  read();
+}
+
+bool
+BackendHealth::should_skip(util::TimePoint now)
+{
+  if (m_failures == 0) {
+    return false;
+  }
+  if (retry_in(now) > 0ns) {
+    return true;
+  }
+
+  util::LockFile lock(m_path);
+  if (!lock.acquire()) {
+    LOG("Failed to acquire lock for {}", m_path);
+    return true;
+  }
+
+  // Another process may have claimed the probe or reset the state since the
+  // file was read.
+  read();
+  if (m_failures == 0) {
+    return false;
+  }
+  if (retry_in(now) > 0ns) {
+    return true;
+  }
+
+  // Claim the probe by starting a new back-off period so that other processes
+  // keep skipping the backend while this one tries it.
+  write(m_failures, now);
+  return false;
+}
+
+std::chrono::nanoseconds
+BackendHealth::retry_in(util::TimePoint now) const
+{
+  if (m_failures == 0) {
+    return 0ns;
+  }
+  return std::max(0ns, m_last_attempt + backoff(m_failures) - now);
+}
+
+void
+BackendHealth::record_failure(util::TimePoint now)
+{
+  util::LockFile lock(m_path);
+  if (!lock.acquire()) {
+    LOG("Failed to acquire lock for {}", m_path);
+    return;
+  }
+  read();
+  write(m_failures + 1, now);
+}
+
+void
+BackendHealth::record_success()
+{
+  if (m_failures == 0) {
+    return;
+  }
+
+  util::LockFile lock(m_path);
+  if (!lock.acquire()) {
+    LOG("Failed to acquire lock for {}", m_path);
+    return;
+  }
+
+  // Keep failures recorded by other processes since this process read the
+  // file.
+  const auto failures = m_failures;
+  const auto last_attempt = m_last_attempt;
+  read();
+  if (m_failures != failures || m_last_attempt != last_attempt) {
+    return;
+  }
+  LOG("Remote storage backend is working again after {} failures",
+      m_failures);
+  m_failures = 0;
+  std::ignore = util::remove(m_path, util::LogFailure::no);
+}
+
+std::chrono::nanoseconds
+BackendHealth::backoff(uint32_t failures)
+{
+  if (failures == 0) {
+    return 0ns;
+  }
+  const uint32_t doublings = std::min(failures - 1, 16U);
+  return std::min(k_initial_backoff * (1U << doublings), k_max_backoff);
+}
+
+void
+BackendHealth::read()
+{
+  m_failures = 0;
+  m_last_attempt = util::TimePoint();
+
+  const auto data = util::read_file<std::string>(m_path);
+  if (!data) {
+    return;
+  }
+  const auto fields = util::split_into_views(*data, " \n");
+  if (fields.size() != 2) {
+    return;
+  }
+  const auto failures = util::parse_unsigned(
+    fields[0], 0, std::numeric_limits<uint32_t>::max(), "failures");
+  const auto last_attempt = util::parse_signed(fields[1]);
+  if (failures && last_attempt) {
+    m_failures = static_cast<uint32_t>(*failures);
+    m_last_attempt = util::TimePoint(std::chrono::nanoseconds(*last_attempt));
+  }
+}
+
+void
+BackendHealth::write(uint32_t failures, util::TimePoint last_attempt)
+{
+  m_failures = failures;
+  m_last_attempt = last_attempt;
+  try {
+    core::AtomicFile file(m_path, core::AtomicFile::Mode::text);
+    file.write(FMT("{} {}\n", failures, util::nsec_tot(last_attempt)));
+    file.commit();
+  } catch (const core::Error& e) {
+    LOG("Failed to write {}: {}", m_path, e.what());
+  }
+}
+
+} // namespace storage
@@ -0,0 +1,72 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <ccache/util/time.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace storage {
+
+// The health of a remote storage backend, shared between ccache processes
+// through a small state file per backend URL. It works like a circuit breaker:
+// after a failure, all processes skip the backend for a back-off period that
+// doubles with each consecutive failure. When the period has expired, the
+// first process to see that claims a new period and probes the backend. If the
+// probe succeeds, the state is reset, and if it fails, the period is doubled.
+// Updates of the state file are done under a lock after rereading the file.
+class BackendHealth
+{
+public:
+  BackendHealth(const std::filesystem::path& dir, std::string_view url);
+
+  // Return true if the backend should be skipped since it has failed recently.
+  // Otherwise, claim the next probe if the backend has failed before.
+  bool should_skip(util::TimePoint now = util::now());
+
+  // Number of consecutive failures recorded for the backend.
+  uint32_t failures() const;
+
+  // Time left until the backend will be tried again.
+  std::chrono::nanoseconds retry_in(util::TimePoint now = util::now()) const;
+
+  void record_failure(util::TimePoint now = util::now());
+  void record_success();
+
+  static std::chrono::nanoseconds backoff(uint32_t failures);
+
+private:
+  std::filesystem::path m_path;
+  uint32_t m_failures = 0;
+  util::TimePoint m_last_attempt;
+
+  void read();
+  void write(uint32_t failures, util::TimePoint last_attempt);
+};
+
+inline uint32_t
+BackendHealth::failures() const
+{
+  return m_failures;
+}
+
+} // namespace storage
@@ -0,0 +1,230 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "frequencysketch.hpp"
+
+#include <ccache/config.hpp>
+#include <ccache/inodecache.hpp>
+#include <ccache/util/conversion.hpp>
+#include <ccache/util/defer.hpp>
+#include <ccache/util/fd.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/filesystem.hpp>
+#include <ccache/util/format.hpp>
+#include <ccache/util/logging.hpp>
+#include <ccache/util/path.hpp>
+#include <ccache/util/temporaryfile.hpp>
+
+#include <fcntl.h>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+
+namespace fs = util::filesystem;
+
+namespace {
+
+// Increment if the format of the shared region changes.
+const uint32_t k_version = 1;
+
+// Note: Increment the version number if constants affecting storage size are
+// changed.
+const uint32_t k_depth = 4;
+const uint32_t k_width = 64 * 1024;
+
+const uint8_t k_max_count = 15;
+
+// Number of increments after which all counters are halved.
+const uint32_t k_sample_size = 10 * k_width;
+
+} // namespace
+
+namespace storage {
+
+struct FrequencySketch::SharedRegion
+{
+  uint32_t version;
+  std::atomic<uint32_t> increments;
+  std::atomic<uint8_t> counters[k_depth][k_width];
+};
+
+static_assert(std::atomic<uint8_t>::is_always_lock_free,
+              "Counters must be lock-free to be shared between processes.");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "Counters must be lock-free to be shared between processes.");
+static_assert(k_depth * sizeof(uint32_t) <= std::tuple_size_v<Hash::Digest>,
+              "The digest must have enough bits for all rows.");
+
+FrequencySketch::FrequencySketch(const Config& config)
+  : m_config(config)
+{
+}
+
+std::optional<uint8_t>
+FrequencySketch::increment(const Hash::Digest& key)
+{
+  if (!initialize()) {
+    return std::nullopt;
+  }
+
+  std::atomic<uint8_t>* counters[k_depth];
+  uint8_t estimate = k_max_count;
+  for (uint32_t row = 0; row < k_depth; ++row) {
+    uint32_t hash;
+    util::big_endian_to_int(key.data() + row * sizeof(hash), hash);
+    counters[row] = &m_sr->counters[row][hash % k_width];
+    estimate =
+      std::min(estimate, counters[row]->load(std::memory_order_relaxed));
+  }
+  if (estimate == k_max_count) {
+    return estimate;
+  }
+
+  // Conservative update: only increment the counters that contributed to the
+  // estimate.
+  for (auto* counter : counters) {
+    uint8_t expected = estimate;
+    counter->compare_exchange_strong(
+      expected, estimate + 1, std::memory_order_relaxed);
+  }
+
+  if (m_sr->increments.fetch_add(1, std::memory_order_relaxed) + 1
+      >= k_sample_size) {
+    m_sr->increments.store(0, std::memory_order_relaxed);
+    for (auto& row : m_sr->counters) {
+      for (auto& counter : row) {
+        counter.store(counter.load(std::memory_order_relaxed) / 2,
+                      std::memory_order_relaxed);
+      }
+    }
+    LOG("Aged remote fill frequency sketch");
+  }
+
+  return estimate + 1;
+}
+
+fs::path
+FrequencySketch::get_path(const Config& config)
+{
+  return config.temporary_dir() / FMT("remote-fill-sketch.v{}", k_version);
+}
+
+bool
+FrequencySketch::initialize()
+{
+  if (m_initialized) {
+    return m_sr != nullptr;
+  }
+  m_initialized = true;
+
+  const auto path = get_path(m_config);
+  util::Fd fd(open(util::pstr(path).c_str(), O_RDWR));
+  if (!fd && errno == ENOENT && create(path)) {
+    fd = util::Fd(open(util::pstr(path).c_str(), O_RDWR));
+  }
+  if (!fd) {
+    return false;
+  }
+  util::set_cloexec_flag(*fd);
+
+  auto map = util::MemoryMap::map(*fd, sizeof(SharedRegion));
+  if (!map) {
+    LOG("Failed to map frequency sketch file {}: {}", path, map.error());
+    return false;
+  }
+  auto sr = reinterpret_cast<SharedRegion*>(map->ptr());
+  if (sr->version != k_version) {
+    LOG("Ignoring frequency sketch {} with version {} (expected {})",
+        path,
+        sr->version,
+        k_version);
+    return false;
+  }
+
+  m_map = std::move(*map);
+  m_sr = sr;
+  return true;
+}
+
+bool
+FrequencySketch::create(const fs::path& path)
+{
+  // Create the new file to a temporary name to prevent other processes from
+  // mapping it before it is fully initialized.
+  auto tmp_file = util::TemporaryFile::create(path);
+  if (!tmp_file) {
+    LOG("Failed to create frequency sketch file: {}", tmp_file.error());
+    return false;
+  }
+  DEFER(unlink(util::pstr(tmp_file->path).c_str()));
+
+  if (!InodeCache::available(*tmp_file->fd)) {
+    LOG("The file system of {} does not support a shared frequency sketch",
+        path.parent_path());
+    return false;
+  }
+  if (auto result = util::fallocate(*tmp_file->fd, sizeof(SharedRegion));
+      !result) {
+    LOG("Failed to allocate file space for frequency sketch: {}",
+        result.error());
+    return false;
+  }
+  auto map = util::MemoryMap::map(*tmp_file->fd, sizeof(SharedRegion));
+  if (!map) {
+    LOG("Failed to map frequency sketch file: {}", map.error());
+    return false;
+  }
+  auto sr = reinterpret_cast<SharedRegion*>(map->ptr());
+  sr->version = k_version;
+  sr->increments = 0;
+  for (auto& row : sr->counters) {
+    for (auto& counter : row) {
+      counter = 0;
+    }
+  }
+  map->unmap();
+  tmp_file->fd.close();
+
+#ifndef _WIN32
+  // Linking fails if another process won a race to create the file, and then
+  // that file is used.
+  if (auto result = fs::create_hard_link(tmp_file->path, path); !result) {
+    if (result.error() != std::errc::file_exists) {
+      LOG("Failed to link frequency sketch file: {}",
+          result.error().message());
+      return false;
+    }
+  }
+#else
+  if (auto result = fs::rename(tmp_file->path, path); !result) {
+    LOG("Failed to rename frequency sketch file: {}", result.error().message());
+    return false;
+  }
+#endif
+
+  LOG("Created frequency sketch {}", path);
+  return true;
+}
+
+} // namespace storage
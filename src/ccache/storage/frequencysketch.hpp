@@ -0,0 +1,66 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#pragma once
+
+#include <ccache/hash.hpp>
+#include <ccache/util/memorymap.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+class Config;
+
+namespace storage {
+
+// A count-min sketch of how often keys have been fetched from remote storage,
+// shared between ccache processes through a file mapped into memory. It is used
+// by the "frequency" remote fill policy to only store entries that are
+// requested repeatedly in local storage, similar to the admission filter in
+// TinyLFU.
+//
+// Counters are four bits wide in spirit (they saturate at 15) and are all
+// halved after a fixed number of increments so that old popularity fades out.
+// Updates are done without locking, so concurrent processes may occasionally
+// lose an increment, which only makes the estimate slightly less accurate.
+class FrequencySketch
+{
+public:
+  explicit FrequencySketch(const Config& config);
+
+  // Record an access of `key` and return the estimated number of accesses
+  // including this one, or std::nullopt if the sketch is not available.
+  std::optional<uint8_t> increment(const Hash::Digest& key);
+
+  static std::filesystem::path get_path(const Config& config);
+
+private:
+  struct SharedRegion;
+
+  bool initialize();
+  bool create(const std::filesystem::path& path);
+
+  const Config& m_config;
+  SharedRegion* m_sr = nullptr;
+  bool m_initialized = false;
+  util::MemoryMap m_map;
+};
+
+} // namespace storage
@@ -0,0 +1,120 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "checkpoint.hpp"
+
+#include <ccache/core/atomicfile.hpp>
+#include <ccache/core/exceptions.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/filesystem.hpp>
+#include <ccache/util/format.hpp>
+#include <ccache/util/logging.hpp>
+#include <ccache/util/string.hpp>
+#include <ccache/util/time.hpp>
+
+namespace fs = util::filesystem;
+
+// File format: The operation on the first line, the creation time (seconds
+// since the Unix epoch) on the second line and then one line per processed
+// level 2 directory with its index in hexadecimal (00-ff).
+
+namespace storage::local {
+
+Checkpoint::Checkpoint(const fs::path& path,
+                       std::string_view operation,
+                       std::chrono::seconds max_age)
+  : m_path(path),
+    m_operation(operation),
+    m_creation_time(util::sec(util::now()))
+{
+  const auto data = util::read_file<std::string>(m_path);
+  if (!data) {
+    return;
+  }
+
+  const auto lines = util::split_into_views(*data, "\n");
+  if (lines.empty() || lines[0] != m_operation) {
+    LOG("Ignoring checkpoint {} for another operation", m_path);
+    return;
+  }
+  const auto creation_time =
+    util::parse_signed(lines.size() < 2 ? std::string_view() : lines[1]);
+  if (!creation_time) {
+    LOG("Ignoring checkpoint {} without creation time", m_path);
+    return;
+  }
+  if (m_creation_time - *creation_time > max_age.count()) {
+    LOG("Ignoring checkpoint {} created {} seconds ago",
+        m_path,
+        m_creation_time - *creation_time);
+    return;
+  }
+  m_creation_time = *creation_time;
+  for (size_t i = 2; i < lines.size(); ++i) {
+    const auto index = util::parse_unsigned(lines[i], 0, 255, "index", 16);
+    if (index) {
+      m_done.set(*index);
+    }
+  }
+  m_resumed_dirs = m_done.count();
+  LOG("Resuming from checkpoint {} with {} processed directories",
+      m_path,
+      m_resumed_dirs);
+}
+
+size_t
+Checkpoint::resumed_dirs() const
+{
+  return m_resumed_dirs;
+}
+
+bool
+Checkpoint::is_done(uint8_t l1_index, uint8_t l2_index) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_done.test(l1_index * 16 + l2_index);
+}
+
+void
+Checkpoint::mark_done(uint8_t l1_index, uint8_t l2_index)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_done.set(l1_index * 16 + l2_index);
+
+  std::string content = FMT("{}\n{}\n", m_operation, m_creation_time);
+  for (size_t i = 0; i < m_done.size(); ++i) {
+    if (m_done.test(i)) {
+      content += FMT("{:02x}\n", i);
+    }
+  }
+  try {
+    core::AtomicFile file(m_path, core::AtomicFile::Mode::text);
+    file.write(content);
+    file.commit();
+  } catch (const core::Error& e) {
+    LOG("Failed to write checkpoint {}: {}", m_path, e.what());
+  }
+}
+
+void
+Checkpoint::remove()
+{
+  std::ignore = util::remove(m_path, util::LogFailure::no);
+}
+
+} // namespace storage::local
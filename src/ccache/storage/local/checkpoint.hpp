@@ -0,0 +1,71 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace storage::local {
+
+// A checkpoint file records which level 2 directories of the local cache a
+// long-running maintenance operation has finished processing, so that the
+// operation can skip them if it is interrupted and started again.
+class Checkpoint
+{
+public:
+  // Checkpoints older than this are ignored by default.
+  static constexpr std::chrono::seconds k_default_max_age{24 * 60 * 60};
+
+  // `operation` identifies the operation and its parameters. A checkpoint
+  // recorded for a different operation or created more than `max_age` ago is
+  // ignored and eventually overwritten. The age is counted from when the first
+  // run of the operation started, since directories processed by that run may
+  // have changed since.
+  Checkpoint(const std::filesystem::path& path,
+             std::string_view operation,
+             std::chrono::seconds max_age = k_default_max_age);
+
+  // Number of directories recorded as done by a previous run.
+  size_t resumed_dirs() const;
+
+  bool is_done(uint8_t l1_index, uint8_t l2_index) const;
+
+  // Record that a directory has been processed. Can be called from several
+  // threads.
+  void mark_done(uint8_t l1_index, uint8_t l2_index);
+
+  // Remove the checkpoint file when the operation has completed.
+  void remove();
+
+private:
+  std::filesystem::path m_path;
+  std::string m_operation;
+  int64_t m_creation_time;
+  std::bitset<256> m_done;
+  size_t m_resumed_dirs = 0;
+  mutable std::mutex m_mutex;
+};
+
+} // namespace storage::local
@@ -0,0 +1,223 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "entryindex.hpp"
+
+#include <ccache/core/atomicfile.hpp>
+#include <ccache/core/cacheentrydatareader.hpp>
+#include <ccache/core/cacheentrydatawriter.hpp>
+#include <ccache/core/exceptions.hpp>
+#include <ccache/util/bytes.hpp>
+#include <ccache/util/fd.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/format.hpp>
+#include <ccache/util/logging.hpp>
+#include <ccache/util/path.hpp>
+#include <ccache/util/temporaryfile.hpp>
+#include <ccache/util/time.hpp>
+#include <ccache/util/wincompat.hpp>
+
+#include <fcntl.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+using util::DirEntry;
+
+// Index file format
+// =================
+//
+// Integers are big-endian.
+//
+// <index>      ::= <version> <record>*
+// <version>    ::= uint8_t
+// <record>     ::= <path_len> <path> <size> <mtime> <header_len> <header>
+// <path_len>   ::= uint16_t
+// <path>       ::= path_len bytes ; relative to the level 2 directory
+// <size>       ::= uint64_t ; file size
+// <mtime>      ::= int64_t ; file modification time in nanoseconds
+// <header_len> ::= uint16_t ; 0 if the file is not a cache entry
+// <header>     ::= header_len bytes ; serialized cache entry header
+//
+// A later record for a path supersedes earlier ones.
+
+namespace {
+
+// Increment if the format of the index changes.
+const uint8_t k_version = 1;
+
+struct Record
+{
+  uint64_t size;
+  int64_t mtime;
+  std::optional<core::CacheEntry::Header> header;
+};
+
+std::string
+relative_path(const fs::path& l2_dir, const DirEntry& file)
+{
+  return util::pstr(file.path().lexically_relative(l2_dir)).str();
+}
+
+void
+serialize_record(util::Bytes& output,
+                 std::string_view path,
+                 const DirEntry& file,
+                 const std::optional<core::CacheEntry::Header>& header)
+{
+  core::CacheEntryDataWriter writer(output);
+  writer.write_int(static_cast<uint16_t>(path.length()));
+  writer.write_str(path);
+  writer.write_int<uint64_t>(file.size());
+  writer.write_int<int64_t>(util::nsec_tot(file.mtime()));
+  if (header) {
+    writer.write_int(static_cast<uint16_t>(header->serialized_size()));
+    header->serialize(output);
+  } else {
+    writer.write_int<uint16_t>(0);
+  }
+}
+
+// Return whether all of `data` could be parsed.
+bool
+parse_index(std::span<const uint8_t> data,
+            std::unordered_map<std::string, Record>& records,
+            size_t& record_count)
+{
+  core::CacheEntryDataReader reader(data);
+  try {
+    if (reader.read_int<uint8_t>() != k_version) {
+      return false;
+    }
+    while (!reader.empty()) {
+      const auto path = reader.read_str(reader.read_int<uint16_t>());
+      Record record;
+      reader.read_int(record.size);
+      reader.read_int(record.mtime);
+      const auto header_data = reader.read_bytes(reader.read_int<uint16_t>());
+      if (!header_data.empty()) {
+        record.header.emplace(header_data);
+      }
+      records.insert_or_assign(std::string(path), std::move(record));
+      ++record_count;
+    }
+  } catch (const core::Error&) {
+    // Truncated record from an interrupted append or a header of an unknown
+    // format. Ignore the rest.
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+namespace storage::local {
+
+EntryIndex::EntryIndex(const fs::path& l2_dir)
+  : m_l2_dir(l2_dir),
+    m_path(get_path(l2_dir))
+{
+}
+
+fs::path
+EntryIndex::get_path(const fs::path& l2_dir)
+{
+  return l2_dir / "index";
+}
+
+void
+EntryIndex::add(const DirEntry& file,
+                const core::CacheEntry::Header& header) const
+{
+  util::Fd fd(
+    open(util::pstr(m_path).c_str(), O_WRONLY | O_APPEND | O_BINARY));
+  if (!fd) {
+    return;
+  }
+
+  // Write the record in one go so that concurrent appends don't interleave.
+  util::Bytes record;
+  serialize_record(record, relative_path(m_l2_dir, file), file, header);
+  if (const auto result = util::write_fd(*fd, record.data(), record.size());
+      !result) {
+    LOG("Failed to write to {}: {}", m_path, result.error());
+  }
+}
+
+std::vector<std::optional<core::CacheEntry::Header>>
+EntryIndex::get_headers(const std::vector<DirEntry>& files) const
+{
+  std::unordered_map<std::string, Record> records;
+  size_t record_count = 0;
+  bool corrupt = false;
+  if (const auto data = util::read_file<util::Bytes>(m_path)) {
+    corrupt = !parse_index(*data, records, record_count);
+  }
+
+  std::vector<std::optional<core::CacheEntry::Header>> headers;
+  headers.reserve(files.size());
+  size_t indexed_files = 0;
+  size_t read_files = 0;
+  util::Bytes new_index{k_version};
+
+  for (const auto& file : files) {
+    auto& header = headers.emplace_back();
+    if (!file.is_regular_file()
+        || util::TemporaryFile::is_tmp_file(file.path())) {
+      continue;
+    }
+
+    const auto path = relative_path(m_l2_dir, file);
+    const auto record = records.find(path);
+    if (record != records.end() && record->second.size == file.size()
+        && record->second.mtime == util::nsec_tot(file.mtime())) {
+      header = std::move(record->second.header);
+      ++indexed_files;
+    } else {
+      try {
+        header.emplace(file.path());
+      } catch (const core::Error&) {
+        // Not a cache entry of the current format, e.g. a raw file.
+      }
+      ++read_files;
+    }
+    serialize_record(new_index, path, file, header);
+  }
+
+  // Rewrite the index if files had to be read or records are stale.
+  if (corrupt || read_files > 0 || record_count > indexed_files) {
+    LOG("Writing {} ({} indexed files, {} read files)",
+        m_path,
+        indexed_files,
+        read_files);
+    try {
+      core::AtomicFile index_file(m_path, core::AtomicFile::Mode::binary);
+      index_file.write(new_index);
+      index_file.commit();
+    } catch (const core::Error& e) {
+      LOG("Failed to write {}: {}", m_path, e.what());
+    }
+  }
+
+  return headers;
+}
+
+} // namespace storage::local
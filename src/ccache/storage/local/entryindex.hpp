@@ -0,0 +1,66 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <ccache/core/cacheentry.hpp>
+#include <ccache/util/direntry.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace storage::local {
+
+// An entry index records the cache entry headers of the files in a level 2
+// directory of the local cache so that maintenance operations (compression
+// statistics, namespace eviction, recompression, cost-aware cleanup) don't
+// have to open every file to learn its namespace, size and compression level.
+//
+// The index is an append-only log of records. Each record identifies a file by
+// its path relative to the level 2 directory, size and modification time, so a
+// record only applies as long as the file is unchanged. Files that have been
+// removed or replaced behind the index's back (for instance by cleanup or an
+// older ccache version) are therefore simply read again, which means that
+// records lost in races between processes only cost performance.
+class EntryIndex
+{
+public:
+  explicit EntryIndex(const std::filesystem::path& l2_dir);
+
+  static std::filesystem::path get_path(const std::filesystem::path& l2_dir);
+
+  // Record `header` for `file`, which has just been written. Nothing is done
+  // if the index doesn't exist; it is created by the first get_headers call.
+  void add(const util::DirEntry& file,
+           const core::CacheEntry::Header& header) const;
+
+  // Return the headers of `files`, which are expected to be the files in the
+  // directory as returned by get_cache_dir_files, in the same order. An element
+  // is std::nullopt if the file is not a cache entry of the current format.
+  // Headers missing from the index are read from the files, in which case the
+  // index is rewritten without stale records.
+  std::vector<std::optional<core::CacheEntry::Header>>
+  get_headers(const std::vector<util::DirEntry>& files) const;
+
+private:
+  std::filesystem::path m_l2_dir;
+  std::filesystem::path m_path;
+};
+
+} // namespace storage::local
@@ -27,6 +27,8 @@
 #include <ccache/core/filerecompressor.hpp>
 #include <ccache/core/manifest.hpp>
 #include <ccache/core/statistics.hpp>
+#include <ccache/storage/local/checkpoint.hpp>
+#include <ccache/storage/local/entryindex.hpp>
 #include <ccache/util/assertions.hpp>
 #include <ccache/util/expected.hpp>
 #include <ccache/util/file.hpp>
@@ -41,7 +43,9 @@
 #include <ccache/util/temporaryfile.hpp>
 #include <ccache/util/texttable.hpp>
 #include <ccache/util/threadpool.hpp>
+#include <ccache/util/throttle.hpp>
 #include <ccache/util/time.hpp>
+#include <ccache/util/timer.hpp>
 #include <ccache/util/wincompat.hpp>
 
 #ifdef INODE_CACHE_SUPPORTED
@@ -77,10 +81,12 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstdlib>
 #include <memory>
 #include <numeric>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 namespace fs = util::filesystem;
@@ -119,6 +125,11 @@ const uint8_t k_min_cache_levels = 2;
 // k_max_cache_files_per_directory.
 const uint8_t k_max_cache_levels = 4;
 
+// Names of the checkpoint files of resumable maintenance operations in the
+// cache directory.
+const char* const k_evict_checkpoint_name = "evict.checkpoint";
+const char* const k_recompress_checkpoint_name = "recompress.checkpoint";
+
 namespace {
 
 struct Level2Counters
@@ -229,6 +240,61 @@ delete_file(core::DryRun dry_run,
   }
 }
 
+// Return the path of the file named `name` (a hexadecimal key possibly followed
+// by a raw file suffix) in the cold tier `cold_tier_dir`.
+static fs::path
+get_cold_tier_path(const fs::path& cold_tier_dir, std::string_view name)
+{
+  return cold_tier_dir / name.substr(0, 1) / name.substr(1, 1)
+         / name.substr(2);
+}
+
+// Return the directory where files to be moved to the cold tier are staged
+// when they can't be renamed there directly.
+static fs::path
+get_cold_tier_staging_dir(const fs::path& cache_dir)
+{
+  return cache_dir / "cold-staging";
+}
+
+// Move `dir_entry` in `l2_dir` to the cold tier instead of deleting it, falling
+// back to deletion on failure. If the cold tier is on another filesystem, the
+// file is moved to the staging directory, to be copied to the cold tier by
+// LocalStorage::move_staged_files_to_cold_tier without holding any locks.
+static void
+demote_file(core::DryRun dry_run,
+            const DirEntry& dir_entry,
+            const fs::path& l2_dir,
+            const fs::path& cold_tier_dir,
+            uint64_t& cache_size,
+            uint64_t& files_in_cache)
+{
+  if (dry_run == core::DryRun::no) {
+    // The cache directory levels are part of the name, e.g. a/b/cdef ->
+    // abcdef.
+    std::string name;
+    const auto cache_dir = l2_dir.parent_path().parent_path();
+    for (const auto& part : dir_entry.path().lexically_relative(cache_dir)) {
+      name += util::pstr(part).str();
+    }
+    const auto dest = get_cold_tier_path(cold_tier_dir, name);
+    const auto staged = get_cold_tier_staging_dir(cache_dir) / name;
+    std::ignore = fs::create_directories(dest.parent_path());
+    if (fs::rename(dir_entry.path(), dest)) {
+      LOG("Demoted {} to {}", dir_entry.path(), dest);
+    } else {
+      // Most likely the cold tier is on another filesystem.
+      std::ignore = fs::create_directories(staged.parent_path());
+      if (fs::rename(dir_entry.path(), staged)) {
+        LOG("Staged {} for demotion to {}", dir_entry.path(), dest);
+      } else {
+        LOG("Failed to demote {} to {}", dir_entry.path(), dest);
+      }
+    }
+  }
+  delete_file(dry_run, dir_entry, cache_size, files_in_cache);
+}
+
 #ifdef FILE_CLONING_SUPPORTED
 
 // Clone a file from `src` to `dest`. If `via_tmp_file` is true, `src` is cloned
@@ -328,6 +394,72 @@ result_path_from_raw_file(const std::string& path)
   return std::nullopt;
 }
 
+// Sort `files` so that the least valuable files to keep come first. The value
+// of an entry is the compile time it saves per byte divided by the time since
+// it was last used, i.e. a GreedyDual-Size priority where the inflation value
+// is replaced by hyperbolic aging since ccache doesn't keep state between
+// cleanups.
+// Raw files share the value of their result entry so that they are removed
+// together. Entries without a recorded compile time (manifests and entries
+// created by older ccache versions) are assumed to save the average compile
+// time per byte.
+static void
+sort_by_eviction_value(std::vector<DirEntry>& files,
+                       const fs::path& l2_dir,
+                       util::TimePoint now)
+{
+  const auto headers = EntryIndex(l2_dir).get_headers(files);
+
+  std::unordered_map<std::string, uint64_t> entry_sizes;
+  for (const auto& file : files) {
+    if (file.is_regular_file()) {
+      const auto path = util::pstr(file.path()).str();
+      entry_sizes[result_path_from_raw_file(path).value_or(path)] +=
+        file.size_on_disk();
+    }
+  }
+
+  std::unordered_map<std::string, double> densities;
+  double known_time = 0;
+  double known_size = 0;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const auto& header = headers[i];
+    if (!header || header->compile_time == 0) {
+      // Not a result entry of the current format or unknown compile time.
+      continue;
+    }
+    const auto path = util::pstr(files[i].path()).str();
+    const auto size = entry_sizes[path];
+    if (size > 0) {
+      densities.emplace(path, header->compile_time / static_cast<double>(size));
+      known_time += header->compile_time;
+      known_size += static_cast<double>(size);
+    }
+  }
+  const double default_density = known_size > 0 ? known_time / known_size : 1;
+
+  std::vector<std::pair<double, size_t>> values;
+  values.reserve(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    const auto path = util::pstr(files[i].path()).str();
+    const auto density =
+      densities.find(result_path_from_raw_file(path).value_or(path));
+    const double age = std::max(
+      std::chrono::duration<double>(now - files[i].mtime()).count(), 1.0);
+    values.emplace_back(
+      (density != densities.end() ? density->second : default_density) / age,
+      i);
+  }
+  std::sort(values.begin(), values.end());
+
+  std::vector<DirEntry> sorted_files;
+  sorted_files.reserve(files.size());
+  for (const auto& [value, index] : values) {
+    sorted_files.push_back(std::move(files[index]));
+  }
+  files = std::move(sorted_files);
+}
+
 static CleanDirResult
 clean_dir(
   core::DryRun dry_run,
@@ -336,7 +468,10 @@ clean_dir(
   const uint64_t max_files,
   const std::optional<uint64_t> max_age = std::nullopt,
   const std::optional<std::string> namespace_ = std::nullopt,
-  const ProgressReceiver& progress_receiver = [](double /*progress*/) {})
+  const ProgressReceiver& progress_receiver = [](double /*progress*/) {},
+  util::Throttle* throttle = nullptr,
+  const fs::path& cold_tier_dir = {},
+  EvictionPolicy eviction_policy = EvictionPolicy::lru)
 {
   LOG("Cleaning up cache directory {}", l2_dir);
 
@@ -386,10 +521,26 @@ clean_dir(
     files_in_cache += 1;
   }
 
-  // Sort according to modification time, oldest first.
-  std::sort(files.begin(), files.end(), [](const auto& f1, const auto& f2) {
-    return f1.mtime() < f2.mtime();
-  });
+  // Namespaces of entries, looked up before sorting.
+  std::unordered_map<std::string, std::string> namespaces;
+  if (namespace_) {
+    const auto headers = EntryIndex(l2_dir).get_headers(files);
+    for (size_t i = 0; i < files.size(); ++i) {
+      if (headers[i]) {
+        namespaces.emplace(util::pstr(files[i].path()).str(),
+                           headers[i]->namespace_);
+      }
+    }
+  }
+
+  if (eviction_policy == EvictionPolicy::cost && !max_age && !namespace_) {
+    sort_by_eviction_value(files, l2_dir, current_time);
+  } else {
+    // Sort according to modification time, oldest first.
+    std::sort(files.begin(), files.end(), [](const auto& f1, const auto& f2) {
+      return f1.mtime() < f2.mtime();
+    });
+  }
 
   LOG("Before cleanup: {:.0f} KiB, {:.0f} files",
       static_cast<double>(cache_size) / 1024,
@@ -416,13 +567,10 @@ clean_dir(
     }
 
     if (namespace_) {
-      try {
-        core::CacheEntry::Header header(file.path());
-        if (header.namespace_ != *namespace_) {
-          continue;
-        }
-      } catch (core::Error&) {
-        // Failed to read header: ignore.
+      const auto entry_namespace = namespaces.find(util::pstr(file.path()));
+      if (entry_namespace == namespaces.end()
+          || entry_namespace->second != *namespace_) {
+        // Other namespace or failed to read header: ignore.
         continue;
       }
 
@@ -436,7 +584,15 @@ clean_dir(
       }
     }
 
-    delete_file(dry_run, file, cache_size, files_in_cache);
+    if (throttle) {
+      throttle->consume(file.size_on_disk());
+    }
+    if (cold_tier_dir.empty()) {
+      delete_file(dry_run, file, cache_size, files_in_cache);
+    } else {
+      demote_file(
+        dry_run, file, l2_dir, cold_tier_dir, cache_size, files_in_cache);
+    }
     cleaned = true;
   }
 
@@ -452,6 +608,17 @@ clean_dir(
   return {counters_before, counters_after};
 }
 
+static void
+print_resume_message(const Checkpoint& checkpoint)
+{
+  if (checkpoint.resumed_dirs() > 0) {
+    PRINT(stdout,
+          "Resuming interrupted operation ({} of 256 directories already"
+          " processed)\n",
+          checkpoint.resumed_dirs());
+  }
+}
+
 LocalStorage::LocalStorage(const Config& config)
   : m_config(config)
 {
@@ -492,6 +659,7 @@ LocalStorage::finalize()
       }
 
       perform_automatic_cleanup();
+      move_staged_files_to_cold_tier();
     }
   }
 
@@ -520,6 +688,8 @@ LocalStorage::get(const Hash::Digest& key, const core::CacheEntryType type)
     } else {
       LOG("Failed to read {}: {}", cache_file.path, value.error());
     }
+  } else if (!m_config.cold_cache_dir().empty()) {
+    return_value = promote_from_cold_tier(key);
   } else {
     LOG("No {} in local storage", util::format_base16(key));
   }
@@ -533,7 +703,86 @@ LocalStorage::get(const Hash::Digest& key, const core::CacheEntryType type)
   return return_value;
 }
 
-void
+namespace {
+
+class RawFileCollector : public core::result::Deserializer::Visitor
+{
+public:
+  void
+  on_embedded_file(uint8_t /*file_number*/,
+                   core::result::FileType /*file_type*/,
+                   std::span<const uint8_t> /*data*/) override
+  {
+  }
+
+  void
+  on_raw_file(uint8_t file_number,
+              core::result::FileType /*file_type*/,
+              uint64_t /*file_size*/) override
+  {
+    file_numbers.push_back(file_number);
+  }
+
+  std::vector<uint8_t> file_numbers;
+};
+
+} // namespace
+
+std::optional<util::Bytes>
+LocalStorage::promote_from_cold_tier(const Hash::Digest& key)
+{
+  const auto cold_path =
+    get_cold_tier_path(m_config.cold_cache_dir(), util::format_base16(key));
+  auto value = util::read_file<util::Bytes>(cold_path);
+  if (!value) {
+    LOG("No {} in local storage", util::format_base16(key));
+    return std::nullopt;
+  }
+
+  std::vector<fs::path> cold_files{cold_path};
+  try {
+    core::CacheEntry cache_entry(*value);
+    cache_entry.verify_checksum();
+    if (m_config.read_only() || m_config.read_only_direct()) {
+      if (!cache_entry.header().self_contained) {
+        LOG("Not using {} from cold tier in read-only mode since it has raw"
+            " files",
+            cold_path);
+        return std::nullopt;
+      }
+      LOG("Retrieved {} from cold tier ({})",
+          util::format_base16(key),
+          cold_path);
+      return *value;
+    }
+    if (!cache_entry.header().self_contained) {
+      RawFileCollector collector;
+      core::result::Deserializer(cache_entry.payload()).visit(collector);
+      std::vector<core::result::Serializer::RawFile> raw_files;
+      for (const auto file_number : collector.file_numbers) {
+        const auto raw_path = get_raw_file_path(cold_path, file_number);
+        raw_files.push_back({file_number, raw_path});
+        cold_files.push_back(raw_path);
+      }
+      put_raw_files(key, raw_files);
+    }
+  } catch (const core::Error& e) {
+    LOG("Failed to promote {}: {}", cold_path, e.what());
+    return std::nullopt;
+  }
+
+  if (!put(key, *value, Overwrite::yes)) {
+    LOG("Failed to promote {}, keeping it in the cold tier", cold_path);
+    return *value;
+  }
+  for (const auto& path : cold_files) {
+    std::ignore = util::remove_nfs_safe(path, util::LogFailure::no);
+  }
+  LOG("Promoted {} from cold tier ({})", util::format_base16(key), cold_path);
+  return *value;
+}
+
+bool
 LocalStorage::put(const Hash::Digest& key,
                   std::span<const uint8_t> value,
                   Overwrite overwrite)
@@ -542,37 +791,107 @@ LocalStorage::put(const Hash::Digest& key,
   if (overwrite == Overwrite::no && cache_file.dir_entry.exists()) {
     LOG("Not storing {} in local storage since it already exists",
         cache_file.path);
-    return;
+    return true;
   }
 
   auto l2_content_lock = get_level_2_content_lock(key);
+  double write_time = 0;
 
   try {
     AtomicFile result_file(cache_file.path, AtomicFile::Mode::binary);
+    util::Timer write_timer;
     result_file.write(value);
     result_file.flush();
+    write_time = write_timer.measure_s();
     if (!l2_content_lock.acquire()) {
       LOG("Not storing {} due to lock failure", cache_file.path);
-      return;
+      return false;
     }
+    // Closing the file is where data reaches the storage on network
+    // filesystems, so include it but not the lock wait in the write time.
+    util::Timer commit_timer;
     result_file.commit();
+    write_time += commit_timer.measure_s();
   } catch (core::Error& e) {
     LOG("Failed to write to {}: {}", cache_file.path, e.what());
-    return;
+    return false;
+  }
+
+  on_entry_stored(key, cache_file, value, write_time, l2_content_lock);
+  return true;
+}
+
+std::optional<util::Bytes>
+LocalStorage::merge(const Hash::Digest& key, const EntryMerger& merger)
+{
+  auto l2_content_lock = get_level_2_content_lock(key);
+  if (!l2_content_lock.acquire()) {
+    LOG("Not merging {} due to lock failure", util::format_base16(key));
+    return std::nullopt;
+  }
+
+  // Look up the entry after acquiring the lock so that an entry stored by a
+  // concurrent merge is seen.
+  const auto cache_file = look_up_cache_file(key);
+  std::optional<util::Bytes> current;
+  if (cache_file.dir_entry.is_regular_file()) {
+    auto data = util::read_file<util::Bytes>(cache_file.path);
+    if (data) {
+      current = std::move(*data);
+    } else {
+      LOG("Failed to read {}: {}", cache_file.path, data.error());
+    }
+  }
+
+  auto value = merger(std::move(current));
+  if (!value) {
+    return std::nullopt;
+  }
+
+  double write_time = 0;
+  try {
+    AtomicFile result_file(cache_file.path, AtomicFile::Mode::binary);
+    util::Timer write_timer;
+    result_file.write(*value);
+    result_file.commit();
+    write_time = write_timer.measure_s();
+  } catch (core::Error& e) {
+    LOG("Failed to write to {}: {}", cache_file.path, e.what());
+    return value;
   }
 
+  on_entry_stored(key, cache_file, *value, write_time, l2_content_lock);
+  return value;
+}
+
+void
+LocalStorage::on_entry_stored(const Hash::Digest& key,
+                              const LookUpCacheFileResult& cache_file,
+                              std::span<const uint8_t> value,
+                              double write_time,
+                              util::LockFile& l2_content_lock)
+{
   LOG("Stored {} in local storage ({})",
       util::format_base16(key),
       cache_file.path);
   m_stored_data = true;
 
+  DirEntry new_dir_entry(cache_file.path, DirEntry::LogOnError::yes);
+  if (new_dir_entry.exists()) {
+    try {
+      EntryIndex(get_subdir(key[0] >> 4, key[0] & 0xF))
+        .add(new_dir_entry, core::CacheEntry::Header(value));
+    } catch (const core::Error& e) {
+      LOG("Failed to parse header of {}: {}", cache_file.path, e.what());
+    }
+  }
+
   if (!m_config.stats()) {
     return;
   }
 
   increment_statistic(Statistic::local_storage_write);
 
-  DirEntry new_dir_entry(cache_file.path, DirEntry::LogOnError::yes);
   if (!new_dir_entry.exists()) {
     return;
   }
@@ -580,8 +899,13 @@ LocalStorage::put(const Hash::Digest& key,
   int64_t files_change = cache_file.dir_entry.exists() ? 0 : 1;
   int64_t size_change_kibibyte =
     kibibyte_size_diff(cache_file.dir_entry, new_dir_entry);
-  auto counters =
-    increment_files_and_size_counters(key, files_change, size_change_kibibyte);
+  auto counters = increment_files_and_size_counters(
+    key,
+    files_change,
+    size_change_kibibyte,
+    value.size(),
+    // Round up so that fast writes don't count as taking no time.
+    static_cast<uint64_t>(std::ceil(write_time * 1'000'000)));
 
   l2_content_lock.release();
 
@@ -624,6 +948,12 @@ LocalStorage::remove(const Hash::Digest& key)
     key, -1, -static_cast<int64_t>(cache_file.dir_entry.size_on_disk() / 1024));
 }
 
+bool
+LocalStorage::exists(const Hash::Digest& key) const
+{
+  return look_up_cache_file(key).dir_entry.is_regular_file();
+}
+
 fs::path
 LocalStorage::get_raw_file_path(const fs::path& result_path,
                                 uint8_t file_number)
@@ -734,6 +1064,7 @@ LocalStorage::increment_statistic(const Statistic statistic,
                                   const int64_t value)
 {
   if (m_config.stats()) {
+    std::lock_guard<std::mutex> lock(m_counter_updates_mutex);
     m_counter_updates.increment(statistic, value);
   }
 }
@@ -742,6 +1073,7 @@ void
 LocalStorage::increment_statistics(const StatisticsCounters& statistics)
 {
   if (m_config.stats()) {
+    std::lock_guard<std::mutex> lock(m_counter_updates_mutex);
     m_counter_updates.increment(statistics);
   }
 }
@@ -787,13 +1119,60 @@ LocalStorage::get_all_statistics() const
   return {counters, last_updated};
 }
 
+double
+LocalStorage::estimated_write_bandwidth(const Hash::Digest& key) const
+{
+  const auto counters = get_stats_file(key[0] >> 4).read();
+  const auto bytes = counters.get(Statistic::local_storage_write_byte);
+  const auto microseconds =
+    counters.get(Statistic::local_storage_write_microsecond);
+  if (bytes == 0 || microseconds == 0) {
+    return 0;
+  }
+  return static_cast<double>(bytes) * 1'000'000
+         / static_cast<double>(microseconds);
+}
+
 void
 LocalStorage::evict(core::DryRun dry_run,
                     const ProgressReceiver& progress_receiver,
                     std::optional<uint64_t> max_age,
-                    std::optional<std::string> namespace_)
+                    std::optional<std::string> namespace_,
+                    uint64_t io_limit)
 {
-  do_clean_all(dry_run, progress_receiver, 0, 0, max_age, namespace_);
+  util::Throttle throttle(io_limit);
+  if (dry_run == core::DryRun::yes) {
+    do_clean_all(dry_run,
+                 progress_receiver,
+                 0,
+                 0,
+                 max_age,
+                 namespace_,
+                 nullptr,
+                 &throttle);
+    return;
+  }
+
+  Checkpoint checkpoint(
+    m_config.cache_dir() / k_evict_checkpoint_name,
+    FMT("evict {} {}",
+        max_age ? std::to_string(*max_age) : "-",
+        namespace_ ? *namespace_ : "-"),
+    // Directories processed longer ago than `max_age` may again contain
+    // entries older than `max_age`.
+    max_age ? std::min(Checkpoint::k_default_max_age,
+                       std::chrono::seconds(static_cast<int64_t>(*max_age)))
+            : Checkpoint::k_default_max_age);
+  print_resume_message(checkpoint);
+  do_clean_all(dry_run,
+               progress_receiver,
+               0,
+               0,
+               max_age,
+               namespace_,
+               &checkpoint,
+               &throttle);
+  checkpoint.remove();
 }
 
 void
@@ -832,6 +1211,9 @@ LocalStorage::wipe_all(const ProgressReceiver& progress_receiver)
             l2_progress_receiver(0.5 + 0.5 * ratio(i, files.size()));
           }
 
+          std::ignore = util::remove(EntryIndex::get_path(l2_dir),
+                                     util::LogFailure::no);
+
           if (!files.empty()) {
             ++level_1_counters.cleanups;
           }
@@ -839,6 +1221,13 @@ LocalStorage::wipe_all(const ProgressReceiver& progress_receiver)
 
       set_counters(get_stats_file(l1_index), level_1_counters);
     });
+
+  // Progress of interrupted maintenance operations no longer applies.
+  for (const auto* name :
+       {k_evict_checkpoint_name, k_recompress_checkpoint_name}) {
+    std::ignore =
+      util::remove(m_config.cache_dir() / name, util::LogFailure::no);
+  }
 }
 
 CompressionStatistics
@@ -850,48 +1239,38 @@ LocalStorage::get_compression_statistics(
   std::atomic<uint64_t> incompressible_size = 0;
   std::atomic<uint32_t> completed_dirs = 0;
 
-  const size_t read_ahead =
-    std::max(static_cast<size_t>(10), 2 * static_cast<size_t>(threads));
-  util::ThreadPool thread_pool(threads, read_ahead);
-
-  std::vector<std::future<void>> futures;
-  futures.reserve(256);
-
-  for_each_cache_subdir([&](uint8_t l1_index) {
-    for_each_cache_subdir([&](uint8_t l2_index) {
-      futures.push_back(thread_pool.enqueue([&, l1_index, l2_index] {
-        auto l2_dir = get_subdir(l1_index, l2_index);
-        const auto files = get_cache_dir_files(l2_dir);
-
-        uint64_t local_content_size = 0;
-        uint64_t local_actual_size = 0;
-        uint64_t local_incompressible_size = 0;
-
-        for (const auto& cache_file : files) {
-          try {
-            core::CacheEntry::Header header(cache_file.path());
-            local_actual_size += cache_file.size_on_disk();
-            local_content_size += util::likely_size_on_disk(header.entry_size);
-          } catch (core::Error&) {
-            local_incompressible_size += cache_file.size_on_disk();
-          }
-        }
+  // The calling thread takes part in parallel_for.
+  util::ThreadPool thread_pool(threads - 1);
+  thread_pool.parallel_for(0, 256, [&](size_t dir_index) {
+    const auto l2_dir = get_subdir(static_cast<uint8_t>(dir_index / 16),
+                                   static_cast<uint8_t>(dir_index % 16));
+    const auto files = get_cache_dir_files(l2_dir);
+
+    const auto headers = EntryIndex(l2_dir).get_headers(files);
+
+    uint64_t local_content_size = 0;
+    uint64_t local_actual_size = 0;
+    uint64_t local_incompressible_size = 0;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+      if (headers[i]) {
+        local_actual_size += files[i].size_on_disk();
+        local_content_size +=
+          util::likely_size_on_disk(headers[i]->entry_size);
+      } else {
+        local_incompressible_size += files[i].size_on_disk();
+      }
+    }
 
-        // Atomic updates (fewer atomic ops by accumulating locally first).
-        content_size += local_content_size;
-        actual_size += local_actual_size;
-        incompressible_size += local_incompressible_size;
-        ++completed_dirs;
+    // Atomic updates (fewer atomic ops by accumulating locally first).
+    content_size += local_content_size;
+    actual_size += local_actual_size;
+    incompressible_size += local_incompressible_size;
+    ++completed_dirs;
 
-        progress_receiver(completed_dirs / 256.0);
-      }));
-    });
+    progress_receiver(completed_dirs / 256.0);
   });
 
-  for (auto& future : futures) {
-    future.get();
-  }
-
   thread_pool.shut_down();
 
   return CompressionStatistics{
@@ -901,12 +1280,16 @@ LocalStorage::get_compression_statistics(
 void
 LocalStorage::recompress(const std::optional<int8_t> level,
                          const uint32_t threads,
-                         const ProgressReceiver& progress_receiver)
+                         const ProgressReceiver& progress_receiver,
+                         const uint64_t io_limit)
 {
-  const size_t read_ahead =
-    std::max(static_cast<size_t>(10), 2 * static_cast<size_t>(threads));
-  util::ThreadPool thread_pool(threads, read_ahead);
+  util::ThreadPool thread_pool(threads);
   core::FileRecompressor recompressor;
+  util::Throttle throttle(io_limit);
+  Checkpoint checkpoint(
+    m_config.cache_dir() / k_recompress_checkpoint_name,
+    FMT("recompress {}", level ? std::to_string(*level) : "uncompressed"));
+  print_resume_message(checkpoint);
 
   std::atomic<uint64_t> incompressible_size = 0;
   std::atomic<uint32_t> completed_dirs = 0;
@@ -917,7 +1300,14 @@ LocalStorage::recompress(const std::optional<int8_t> level,
 
   for_each_cache_subdir([&](uint8_t l1_index) {
     for_each_cache_subdir([&](uint8_t l2_index) {
+      if (checkpoint.is_done(l1_index, l2_index)) {
+        ++completed_dirs;
+        return;
+      }
       futures.push_back(thread_pool.enqueue([&, l1_index, l2_index, level] {
+        // Only hold the content lock while listing files and replacing
+        // recompressed files so that compilations storing results in the
+        // directory are not blocked.
         auto l2_content_lock = get_level_2_content_lock(l1_index, l2_index);
         l2_content_lock.make_long_lived(lock_manager);
         if (!l2_content_lock.acquire()) {
@@ -932,65 +1322,95 @@ LocalStorage::recompress(const std::optional<int8_t> level,
           progress_receiver(static_cast<double>(completed_dirs) / 256.0);
           return;
         }
+        const auto l2_dir = get_subdir(l1_index, l2_index);
+        const auto files = get_cache_dir_files(l2_dir);
+        const EntryIndex index(l2_dir);
+        auto headers = index.get_headers(files);
+        l2_content_lock.release();
 
-        auto l2_dir = get_subdir(l1_index, l2_index);
-        auto files = get_cache_dir_files(l2_dir);
+        const auto wanted_level =
+          core::FileRecompressor::wanted_compression_level(level);
         auto stats_file = get_stats_file(l1_index);
-
-        for (const auto& file : files) {
-          if (!util::TemporaryFile::is_tmp_file(file.path())) {
-            thread_pool.enqueue_detach([&, file, l2_index, stats_file, level] {
-              try {
-                DirEntry new_dir_entry = recompressor.recompress(
-                  file, level, core::FileRecompressor::KeepAtime::no);
-                auto old_size = file.size();
-                auto new_size = new_dir_entry.size();
-                // Not using LOG here due to GCC 12.3 bug #109241.
-                if (new_size != old_size) {
-                  if (util::logging::enabled()) {
-                    util::logging::log(
-                      FMT("Recompressed {} from {} to {} bytes",
-                          file.path(),
-                          old_size,
-                          new_size));
-                  }
-                  auto size_change_kibibyte =
-                    kibibyte_size_diff(file, new_dir_entry);
-                  if (size_change_kibibyte != 0) {
-                    StatsFile(stats_file).update([=](auto& cs) {
-                      cs.increment(Statistic::cache_size_kibibyte,
-                                   size_change_kibibyte);
-                      cs.increment_offsetted(
-                        Statistic::subdir_size_kibibyte_base,
-                        l2_index,
-                        size_change_kibibyte);
-                    });
-                  }
-                }
-              } catch (core::Error& e) {
-                // Not using LOG here due to GCC 12.3 bug #109241.
-                if (util::logging::enabled()) {
-                  util::logging::log(FMT(
-                    "Error when recompressing {}: {}", file.path(), e.what()));
-                }
-                incompressible_size += file.size_on_disk();
+        for (size_t i = 0; i < files.size(); ++i) {
+          const auto& file = files[i];
+          auto& header = headers[i];
+          if (util::TemporaryFile::is_tmp_file(file.path())) {
+            continue;
+          }
+          if (!header) {
+            incompressible_size += file.size_on_disk();
+            continue;
+          }
+          // Files already at the wanted level are not read.
+          const bool rewritten = header->compression_level != wanted_level;
+          if (rewritten) {
+            throttle.consume(file.size());
+          }
+          try {
+            const auto recompressed =
+              recompressor.recompress(file,
+                                      *header,
+                                      level,
+                                      core::FileRecompressor::KeepAtime::no,
+                                      &l2_content_lock);
+            if (!recompressed) {
+              // Removed by a concurrent cleanup (and possibly stored again)
+              // after it was listed, so leave the counters alone.
+              continue;
+            }
+            const DirEntry& new_dir_entry = *recompressed;
+            auto old_size = file.size();
+            auto new_size = new_dir_entry.size();
+            if (rewritten) {
+              throttle.consume(new_size);
+              // The recompressor restores the modification time, so stat the
+              // file again for the index record.
+              index.add(DirEntry(file.path()), *header);
+            }
+            // Not using LOG here due to GCC 12.3 bug #109241.
+            if (new_size != old_size) {
+              if (util::logging::enabled()) {
+                util::logging::log(FMT("Recompressed {} from {} to {} bytes",
+                                       file.path(),
+                                       old_size,
+                                       new_size));
+              }
+              auto size_change_kibibyte =
+                kibibyte_size_diff(file, new_dir_entry);
+              if (size_change_kibibyte != 0) {
+                stats_file.update([=](auto& cs) {
+                  cs.increment(Statistic::cache_size_kibibyte,
+                               size_change_kibibyte);
+                  cs.increment_offsetted(Statistic::subdir_size_kibibyte_base,
+                                         l2_index,
+                                         size_change_kibibyte);
+                });
               }
-            });
+            }
+          } catch (core::Error& e) {
+            // Not using LOG here due to GCC 12.3 bug #109241.
+            if (util::logging::enabled()) {
+              util::logging::log(FMT(
+                "Error when recompressing {}: {}", file.path(), e.what()));
+            }
+            incompressible_size += file.size_on_disk();
           }
         }
 
+        checkpoint.mark_done(l1_index, l2_index);
         ++completed_dirs;
         progress_receiver(static_cast<double>(completed_dirs) / 256.0);
       }));
     });
   });
 
-  // Wait for all directory scanning tasks to complete.
+  // Wait for all directory tasks to complete.
   for (auto& future : futures) {
     future.get();
   }
 
   thread_pool.shut_down();
+  checkpoint.remove();
 
   if (isatty(STDOUT_FILENO)) {
     PRINT(stdout, "\n\n");
@@ -1159,13 +1579,19 @@ std::optional<core::StatisticsCounters>
 LocalStorage::increment_files_and_size_counters(uint8_t l1_index,
                                                 uint8_t l2_index,
                                                 int64_t files,
-                                                int64_t size_kibibyte)
+                                                int64_t size_kibibyte,
+                                                uint64_t written_bytes,
+                                                uint64_t write_microseconds)
 {
   const auto level_1_stats_file = get_stats_file(l1_index);
   return level_1_stats_file.update([&](auto& cs) {
     // Level 1 counters:
     cs.increment(Statistic::files_in_cache, files);
     cs.increment(Statistic::cache_size_kibibyte, size_kibibyte);
+    cs.increment(Statistic::local_storage_write_byte,
+                 static_cast<int64_t>(written_bytes));
+    cs.increment(Statistic::local_storage_write_microsecond,
+                 static_cast<int64_t>(write_microseconds));
 
     // Level 2 counters:
     cs.increment_offsetted(Statistic::subdir_files_base, l2_index, files);
@@ -1177,10 +1603,16 @@ LocalStorage::increment_files_and_size_counters(uint8_t l1_index,
 std::optional<core::StatisticsCounters>
 LocalStorage::increment_files_and_size_counters(const Hash::Digest& key,
                                                 int64_t files,
-                                                int64_t size_kibibyte)
+                                                int64_t size_kibibyte,
+                                                uint64_t written_bytes,
+                                                uint64_t write_microseconds)
 {
-  return increment_files_and_size_counters(
-    key[0] >> 4, key[0] & 0xF, files, size_kibibyte);
+  return increment_files_and_size_counters(key[0] >> 4,
+                                           key[0] & 0xF,
+                                           files,
+                                           size_kibibyte,
+                                           written_bytes,
+                                           write_microseconds);
 }
 
 static uint8_t
@@ -1295,7 +1727,13 @@ LocalStorage::perform_automatic_cleanup()
     clean_dir(core::DryRun::no,
               get_subdir(evaluation->l1_index, largest_level_2_index),
               0,
-              target_files);
+              target_files,
+              std::nullopt,
+              std::nullopt,
+              [](double /*progress*/) {},
+              nullptr,
+              m_config.cold_cache_dir(),
+              m_config.eviction_policy());
 
   stats_file.update([&](auto& cs) {
     const auto old_files =
@@ -1325,7 +1763,9 @@ LocalStorage::do_clean_all(core::DryRun dry_run,
                            uint64_t max_size,
                            uint64_t max_files,
                            std::optional<uint64_t> max_age,
-                           std::optional<std::string> namespace_)
+                           std::optional<std::string> namespace_,
+                           Checkpoint* checkpoint,
+                           util::Throttle* throttle)
 {
   util::LongLivedLockFileManager lock_manager;
 
@@ -1340,15 +1780,32 @@ LocalStorage::do_clean_all(core::DryRun dry_run,
   uint64_t total_removed_size = 0;
   uint64_t total_removed_files = 0;
 
+  // Explicit eviction removes files while size-based cleanup demotes them.
+  const fs::path cold_tier_dir =
+    max_age || namespace_ ? fs::path() : m_config.cold_cache_dir();
+
   for_each_cache_subdir(
     progress_receiver, [&](uint8_t l1_index, const auto& l1_progress_receiver) {
       auto acquired_locks =
         acquire_all_level_2_content_locks(lock_manager, l1_index);
       Level1Counters level_1_counters;
+      const auto old_counters =
+        checkpoint ? get_stats_file(l1_index).read() : StatisticsCounters();
 
       for_each_cache_subdir(
         l1_progress_receiver,
         [&](uint8_t l2_index, const ProgressReceiver& l2_progress_receiver) {
+          if (checkpoint && checkpoint->is_done(l1_index, l2_index)) {
+            // Processed by an interrupted run, so keep its counters.
+            level_1_counters.level_2_counters[l2_index] = {
+              old_counters.get_offsetted(Statistic::subdir_files_base,
+                                         l2_index),
+              1024
+                * old_counters.get_offsetted(
+                  Statistic::subdir_size_kibibyte_base, l2_index)};
+            return;
+          }
+
           uint64_t level_2_max_size =
             current_size > max_size ? max_size / 256 : 0;
           uint64_t level_2_max_files =
@@ -1359,7 +1816,10 @@ LocalStorage::do_clean_all(core::DryRun dry_run,
                                             level_2_max_files,
                                             max_age,
                                             namespace_,
-                                            l2_progress_receiver);
+                                            l2_progress_receiver,
+                                            throttle,
+                                            cold_tier_dir,
+                                            m_config.eviction_policy());
           uint64_t removed_size =
             clean_dir_result.before.size - clean_dir_result.after.size;
           uint64_t removed_files =
@@ -1394,9 +1854,20 @@ LocalStorage::do_clean_all(core::DryRun dry_run,
 
       if (dry_run == core::DryRun::no) {
         set_counters(get_stats_file(l1_index), level_1_counters);
+        if (checkpoint) {
+          // Only record progress once the counters of the level 1 directory
+          // have been written.
+          for_each_cache_subdir([&](uint8_t l2_index) {
+            checkpoint->mark_done(l1_index, l2_index);
+          });
+        }
       }
     });
 
+  if (!cold_tier_dir.empty() && dry_run == core::DryRun::no) {
+    move_staged_files_to_cold_tier();
+  }
+
   if (isatty(STDOUT_FILENO)) {
     PRINT(stdout, "\n\n");
   }
@@ -1413,7 +1884,9 @@ LocalStorage::do_clean_all(core::DryRun dry_run,
   using C = util::TextTable::Cell;
   util::TextTable table;
   const char* description =
-    dry_run == core::DryRun::yes ? "Would remove" : "Removed";
+    cold_tier_dir.empty()
+      ? (dry_run == core::DryRun::yes ? "Would remove" : "Removed")
+      : (dry_run == core::DryRun::yes ? "Would demote" : "Demoted");
   table.add_row({FMT("{} data:", description),
                  C(removed_size_quantity).right_align(),
                  *removed_size_unit});
@@ -1421,6 +1894,36 @@ LocalStorage::do_clean_all(core::DryRun dry_run,
   PRINT(stdout, "{}", table.render());
 }
 
+void
+LocalStorage::move_staged_files_to_cold_tier()
+{
+  if (m_config.cold_cache_dir().empty()) {
+    return;
+  }
+
+  const auto staging_dir = get_cold_tier_staging_dir(m_config.cache_dir());
+  if (!DirEntry(staging_dir).is_directory()) {
+    return;
+  }
+
+  // Files left by an interrupted process are moved as well. If several
+  // processes move the same file, the copies are identical.
+  std::ignore = util::traverse_directory(staging_dir, [&](const DirEntry& de) {
+    if (!de.is_regular_file()) {
+      return;
+    }
+    const auto name = util::pstr(de.path().filename()).str();
+    const auto dest = get_cold_tier_path(m_config.cold_cache_dir(), name);
+    std::ignore = fs::create_directories(dest.parent_path());
+    if (util::copy_file(de.path(), dest, util::ViaTmpFile::yes)) {
+      LOG("Demoted {} to {}", de.path(), dest);
+    } else {
+      LOG("Failed to demote {} to {}", de.path(), dest);
+    }
+    std::ignore = util::remove(de.path(), util::LogFailure::no);
+  });
+}
+
 std::optional<LocalStorage::EvaluateCleanupResult>
 LocalStorage::evaluate_cleanup()
 {
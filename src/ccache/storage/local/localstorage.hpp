@@ -32,8 +32,10 @@
 #include <ccache/util/longlivedlockfilemanager.hpp>
 #include <ccache/util/time.hpp>
 
+#include <atomic>
 #include <cstdint>
 #include <filesystem>
+#include <mutex>
 #include <optional>
 #include <span>
 #include <string>
@@ -43,8 +45,14 @@
 
 class Config;
 
+namespace util {
+class Throttle;
+}
+
 namespace storage::local {
 
+class Checkpoint;
+
 struct CompressionStatistics
 {
   // Storage that would be needed to store the content of compressible entries
@@ -71,12 +79,23 @@ public:
   std::optional<util::Bytes> get(const Hash::Digest& key,
                                  core::CacheEntryType type);
 
-  void put(const Hash::Digest& key,
+  // Return false if the entry could not be stored. May be called concurrently
+  // from several threads.
+  bool put(const Hash::Digest& key,
            std::span<const uint8_t> value,
            Overwrite overwrite);
 
+  // Replace the entry for `key` with the value returned by `merger`, which is
+  // called with the current value while holding the level 2 content lock so
+  // that concurrent merges are serialized. Returns the stored value.
+  std::optional<util::Bytes> merge(const Hash::Digest& key,
+                                   const EntryMerger& merger);
+
   void remove(const Hash::Digest& key);
 
+  // Return whether an entry for `key` exists without reading it.
+  bool exists(const Hash::Digest& key) const;
+
   static std::filesystem::path
   get_raw_file_path(const std::filesystem::path& result_path,
                     uint8_t file_number);
@@ -109,12 +128,21 @@ public:
   std::pair<core::StatisticsCounters, util::TimePoint>
   get_all_statistics() const;
 
+  // Return the bandwidth (bytes per second) observed when writing entries to
+  // the level 1 directory of `key`, or 0 if unknown.
+  double estimated_write_bandwidth(const Hash::Digest& key) const;
+
   // --- Cleanup ---
 
+  // Progress is recorded in a checkpoint file in the cache directory so that
+  // an interrupted eviction with the same parameters resumes where it left
+  // off. `io_limit` is the maximum number of bytes of files to remove per
+  // second, 0 for no limit.
   void evict(core::DryRun dry_run,
              const ProgressReceiver& progress_receiver,
              std::optional<uint64_t> max_age,
-             std::optional<std::string> namespace_);
+             std::optional<std::string> namespace_,
+             uint64_t io_limit = 0);
 
   void clean_all(core::DryRun dry_run,
                  const ProgressReceiver& progress_receiver);
@@ -127,9 +155,12 @@ public:
   get_compression_statistics(uint32_t threads,
                              const ProgressReceiver& progress_receiver) const;
 
+  // Like evict, recompression is resumable. `io_limit` is the maximum number
+  // of bytes to read and write per second, 0 for no limit.
   void recompress(std::optional<int8_t> level,
                   uint32_t threads,
-                  const ProgressReceiver& progress_receiver);
+                  const ProgressReceiver& progress_receiver,
+                  uint64_t io_limit = 0);
 
 private:
   const Config& m_config;
@@ -137,6 +168,7 @@ private:
   // Statistics updates (excluding size/count changes) that will get written to
   // a statistics file in the finalize method.
   core::StatisticsCounters m_counter_updates;
+  std::mutex m_counter_updates_mutex;
 
   struct AddedRawFile
   {
@@ -144,7 +176,7 @@ private:
     std::filesystem::path dest_path;
   };
   std::vector<AddedRawFile> m_added_raw_files;
-  bool m_stored_data = false;
+  std::atomic<bool> m_stored_data = false;
 
   struct LookUpCacheFileResult
   {
@@ -155,6 +187,19 @@ private:
 
   LookUpCacheFileResult look_up_cache_file(const Hash::Digest& key) const;
 
+  // Update statistics and cache levels after `cache_file` has been written
+  // while holding `l2_content_lock`, which is released.
+  void on_entry_stored(const Hash::Digest& key,
+                       const LookUpCacheFileResult& cache_file,
+                       std::span<const uint8_t> value,
+                       double write_time,
+                       util::LockFile& l2_content_lock);
+
+  // Move an entry and its raw files from the cold tier (cold_cache_dir) to the
+  // cache directory and return the entry's data. In read-only mode, the entry
+  // is returned without moving it if it has no raw files.
+  std::optional<util::Bytes> promote_from_cold_tier(const Hash::Digest& key);
+
   std::filesystem::path get_subdir(uint8_t l1_index) const;
   std::filesystem::path get_subdir(uint8_t l1_index, uint8_t l2_index) const;
 
@@ -168,19 +213,34 @@ private:
   void recount_level_1_dir(util::LongLivedLockFileManager& lock_manager,
                            uint8_t l1_index);
 
-  std::optional<core::StatisticsCounters> increment_files_and_size_counters(
-    uint8_t l1_index, uint8_t l2_index, int64_t files, int64_t size_kibibyte);
-  std::optional<core::StatisticsCounters> increment_files_and_size_counters(
-    const Hash::Digest& key, int64_t files, int64_t size_kibibyte);
+  std::optional<core::StatisticsCounters>
+  increment_files_and_size_counters(uint8_t l1_index,
+                                    uint8_t l2_index,
+                                    int64_t files,
+                                    int64_t size_kibibyte,
+                                    uint64_t written_bytes = 0,
+                                    uint64_t write_microseconds = 0);
+  std::optional<core::StatisticsCounters>
+  increment_files_and_size_counters(const Hash::Digest& key,
+                                    int64_t files,
+                                    int64_t size_kibibyte,
+                                    uint64_t written_bytes = 0,
+                                    uint64_t write_microseconds = 0);
 
   void perform_automatic_cleanup();
 
+  // Copy files that cleanup could not rename into the cold tier there. Must be
+  // called without holding content locks since copying may be slow.
+  void move_staged_files_to_cold_tier();
+
   void do_clean_all(core::DryRun dry_run,
                     const ProgressReceiver& progress_receiver,
                     uint64_t max_size,
                     uint64_t max_files,
                     std::optional<uint64_t> max_age,
-                    std::optional<std::string> namespace_);
+                    std::optional<std::string> namespace_,
+                    Checkpoint* checkpoint = nullptr,
+                    util::Throttle* throttle = nullptr);
 
   struct EvaluateCleanupResult
   {
@@ -78,7 +78,7 @@ get_cache_dir_files(const fs::path& dir)
   util::throw_on_error<core::Error>(
     util::traverse_directory(dir, [&](const auto& de) {
       std::string name = util::pstr(de.path().filename());
-      if (name == "CACHEDIR.TAG" || name == "stats"
+      if (name == "CACHEDIR.TAG" || name == "stats" || name == "index"
           || name.starts_with(".nfs")) {
         return;
       }
@@ -49,6 +49,7 @@ void for_each_level_1_and_2_stats_file(
 // Files ignored:
 // - CACHEDIR.TAG
 // - stats
+// - index (see EntryIndex)
 // - .nfs* (temporary NFS files that may be left for open but deleted files).
 std::vector<util::DirEntry>
 get_cache_dir_files(const std::filesystem::path& dir);
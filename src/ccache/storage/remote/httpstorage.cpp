@@ -126,6 +126,11 @@ HttpStorageBackend::HttpStorageBackend(
 
   m_http_client.set_keep_alive(true);
 
+  // httplib writes request headers and body with separate send calls, so
+  // without TCP_NODELAY a PUT can stall on Nagle's algorithm waiting for the
+  // server's delayed ACK of the headers.
+  m_http_client.set_tcp_nodelay(true);
+
   auto connect_timeout = k_default_connect_timeout;
   auto operation_timeout = k_default_operation_timeout;
 
@@ -23,6 +23,8 @@
 #include <ccache/core/cacheentry.hpp>
 #include <ccache/core/exceptions.hpp>
 #include <ccache/core/statistic.hpp>
+#include <ccache/storage/backendhealth.hpp>
+#include <ccache/storage/frequencysketch.hpp>
 #include <ccache/storage/remote/filestorage.hpp>
 #include <ccache/storage/remote/helper.hpp>
 #ifdef HAVE_HTTP_STORAGE_BACKEND
@@ -42,6 +44,8 @@
 #include <ccache/util/format.hpp>
 #include <ccache/util/logging.hpp>
 #include <ccache/util/string.hpp>
+#include <ccache/util/threadpool.hpp>
+#include <ccache/util/time.hpp>
 #include <ccache/util/timer.hpp>
 #include <ccache/util/tokenizer.hpp>
 #include <ccache/util/xxh3_64.hpp>
@@ -49,9 +53,14 @@
 #include <cxxurl/url.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <system_error>
 #include <unordered_map>
 #include <vector>
 
@@ -119,6 +128,7 @@ struct RemoteStorageBackendEntry
   std::string url_for_logging; // With expanded "*"
   std::unique_ptr<remote::RemoteStorage::Backend> impl;
   bool failed = false;
+  BackendHealth health; // Shared with other ccache processes
 };
 
 // An instantiated remote storage.
@@ -129,6 +139,16 @@ struct RemoteStorageEntry
   std::vector<RemoteStorageBackendEntry> backends;
 };
 
+// A remote storage get operation running in the background.
+struct RemoteStoragePrefetch
+{
+  Hash::Digest key;
+  remote::RemoteStorage::Backend* backend; // Owned by a backend entry.
+  std::future<tl::expected<std::optional<util::Bytes>,
+                           remote::RemoteStorage::Backend::Failure>>
+    result;
+};
+
 static std::string
 to_string(const storage::RemoteStorageConfig& entry)
 {
@@ -430,6 +450,7 @@ Storage::~Storage() = default;
 void
 Storage::finalize()
 {
+  discard_prefetch();
   local.finalize();
 }
 
@@ -452,12 +473,50 @@ Storage::get(const Hash::Hash::Digest& key,
 
   get_from_remote_storage(key, type, [&](util::Bytes&& data) {
     if (!m_config.remote_only()) {
-      local.put(key, data, Overwrite::no);
+      if (should_fill_local_storage(key, data.size())) {
+        local.put(key, data, Overwrite::no);
+      } else {
+        LOG("Not storing {} in local storage due to remote fill policy",
+            util::format_base16(key));
+        local.increment_statistic(core::Statistic::remote_storage_fill_skipped);
+      }
     }
     return entry_receiver(std::move(data));
   });
 }
 
+bool
+Storage::should_fill_local_storage(const Hash::Digest& key, size_t size)
+{
+  switch (m_config.remote_fill_policy()) {
+  case RemoteFillPolicy::always:
+    return true;
+
+  case RemoteFillPolicy::frequency:
+#ifdef INODE_CACHE_SUPPORTED
+  {
+    if (!m_frequency_sketch) {
+      m_frequency_sketch = std::make_unique<FrequencySketch>(m_config);
+    }
+    // Like the TinyLFU doorkeeper: an entry seen for the first time is likely
+    // a one-off, so only store it when it is fetched again.
+    const auto count = m_frequency_sketch->increment(key);
+    return !count || *count >= 2;
+  }
+#else
+    return true;
+#endif
+
+  case RemoteFillPolicy::never:
+    return false;
+
+  case RemoteFillPolicy::size:
+    return size <= m_config.remote_fill_max_size();
+  }
+
+  ASSERT(false);
+}
+
 void
 Storage::put(const Hash::Digest& key, std::span<const uint8_t> value)
 {
@@ -467,6 +526,52 @@ Storage::put(const Hash::Digest& key, std::span<const uint8_t> value)
   put_in_remote_storage(key, value, Overwrite::yes);
 }
 
+void
+Storage::merge(const Hash::Digest& key, const EntryMerger& merger)
+{
+  std::optional<util::Bytes> value;
+  if (!m_config.remote_only()) {
+    value = local.merge(key, merger);
+  } else {
+    value = merger(get_from_remote_storage_for_merge(key));
+  }
+  if (value) {
+    put_in_remote_storage(key, *value, Overwrite::yes);
+  }
+}
+
+void
+Storage::prefetch(const Hash::Digest& key)
+{
+  if (m_config.remote_storage().empty() || m_prefetch
+      || (!m_config.remote_only() && local.exists(key))) {
+    return;
+  }
+
+  init_remote_storage();
+
+  for (const auto& entry : m_remote_storages) {
+    auto backend = get_backend(*entry, key, "prefetching from", false);
+    if (!backend) {
+      continue;
+    }
+
+    LOG("Prefetching {} from {}",
+        util::format_base16(key),
+        backend->url_for_logging);
+    auto* impl = backend->impl.get();
+    try {
+      auto result =
+        std::async(std::launch::async, [impl, key] { return impl->get(key); });
+      m_prefetch = std::make_unique<RemoteStoragePrefetch>(
+        RemoteStoragePrefetch{key, impl, std::move(result)});
+    } catch (const std::system_error& e) {
+      LOG("Failed to start prefetch: {}", e.what());
+    }
+    return;
+  }
+}
+
 void
 Storage::remove(const Hash::Digest& key)
 {
@@ -521,6 +626,41 @@ Storage::init_remote_storage()
   }
 }
 
+std::unique_ptr<RemoteStoragePrefetch>
+Storage::take_prefetch(const Hash::Digest& key)
+{
+  if (m_prefetch && m_prefetch->key == key) {
+    return std::move(m_prefetch);
+  }
+  discard_prefetch();
+  return {};
+}
+
+void
+Storage::discard_prefetch()
+{
+  if (!m_prefetch) {
+    return;
+  }
+
+  // The backend must not be used concurrently, so wait for the request to
+  // finish even though the value is not wanted.
+  const auto prefetch = std::move(m_prefetch);
+  const auto result = prefetch->result.get();
+  LOG("Discarded prefetched {}", util::format_base16(prefetch->key));
+  if (result) {
+    return;
+  }
+  for (const auto& entry : m_remote_storages) {
+    for (auto& backend : entry->backends) {
+      if (backend.impl.get() == prefetch->backend) {
+        mark_backend_as_failed(backend, result.error());
+        return;
+      }
+    }
+  }
+}
+
 void
 Storage::mark_backend_as_failed(
   RemoteStorageBackendEntry& backend_entry,
@@ -530,6 +670,7 @@ Storage::mark_backend_as_failed(
   LOG("Marking remote storage backend for {} as failed",
       backend_entry.url.scheme());
   backend_entry.failed = true;
+  backend_entry.health.record_failure();
   local.increment_statistic(
     failure == remote::RemoteStorage::Backend::Failure::timeout
       ? core::Statistic::remote_storage_timeout
@@ -597,7 +738,23 @@ Storage::get_backend(RemoteStorageEntry& entry,
                  [&](const auto& x) { return x.url.str() == shard_url.str(); });
 
   if (backend == entry.backends.end()) {
-    entry.backends.push_back({shard_url, url_str_for_logging, {}, false});
+    entry.backends.push_back(
+      {shard_url,
+       url_str_for_logging,
+       {},
+       false,
+       BackendHealth(m_config.temporary_dir(), shard_url.str())});
+    auto& health = entry.backends.back().health;
+    if (health.should_skip()) {
+      LOG("Not {} {} since it failed {} time{} in a row, retrying in {:.1f} s",
+          operation_description,
+          url_str_for_logging,
+          health.failures(),
+          health.failures() == 1 ? "" : "s",
+          static_cast<double>(util::nsec_tot(health.retry_in())) / 1e9);
+      entry.backends.back().failed = true;
+      return nullptr;
+    }
     try {
       entry.backends.back().impl =
         entry.storage->create_backend(shard_url, entry.config.attributes);
@@ -625,6 +782,7 @@ Storage::get_from_remote_storage(const Hash::Digest& key,
                                  const EntryReceiver& entry_receiver)
 {
   init_remote_storage();
+  const auto prefetch = take_prefetch(key);
 
   for (const auto& entry : m_remote_storages) {
     auto backend = get_backend(*entry, key, "getting from", false);
@@ -633,13 +791,16 @@ Storage::get_from_remote_storage(const Hash::Digest& key,
     }
 
     util::Timer timer;
-    auto result = backend->impl->get(key);
+    auto result = prefetch && prefetch->backend == backend->impl.get()
+                    ? prefetch->result.get()
+                    : backend->impl->get(key);
     const auto ms = timer.measure_ms();
     if (!result) {
       mark_backend_as_failed(*backend, result.error());
       continue;
     }
 
+    backend->health.record_success();
     auto& value = *result;
     if (value && !value->empty()) {
       LOG("Retrieved {} from {} ({:.2f} ms)",
@@ -669,6 +830,35 @@ Storage::get_from_remote_storage(const Hash::Digest& key,
   }
 }
 
+std::optional<util::Bytes>
+Storage::get_from_remote_storage_for_merge(const Hash::Digest& key)
+{
+  init_remote_storage();
+
+  for (const auto& entry : m_remote_storages) {
+    auto backend = get_backend(*entry, key, "getting from", false);
+    if (!backend) {
+      continue;
+    }
+
+    auto result = backend->impl->get(key);
+    if (!result) {
+      mark_backend_as_failed(*backend, result.error());
+      continue;
+    }
+
+    backend->health.record_success();
+    if (*result && !(*result)->empty()) {
+      LOG("Retrieved {} from {} for merging",
+          util::format_base16(key),
+          backend->url_for_logging);
+      return std::move(**result);
+    }
+  }
+
+  return std::nullopt;
+}
+
 void
 Storage::put_in_remote_storage(const Hash::Digest& key,
                                std::span<const uint8_t> value,
@@ -681,6 +871,7 @@ Storage::put_in_remote_storage(const Hash::Digest& key,
   }
 
   init_remote_storage();
+  discard_prefetch();
 
   for (const auto& entry : m_remote_storages) {
     auto backend = get_backend(*entry, key, "putting in", true);
@@ -697,6 +888,7 @@ Storage::put_in_remote_storage(const Hash::Digest& key,
       continue;
     }
 
+    backend->health.record_success();
     const bool stored = *result;
     LOG("{} {} in {} ({:.2f} ms)",
         stored ? "Stored" : "Did not have to store",
@@ -711,6 +903,7 @@ void
 Storage::remove_from_remote_storage(const Hash::Digest& key)
 {
   init_remote_storage();
+  discard_prefetch();
 
   for (const auto& entry : m_remote_storages) {
     auto backend = get_backend(*entry, key, "removing from", true);
@@ -726,6 +919,7 @@ Storage::remove_from_remote_storage(const Hash::Digest& key)
       continue;
     }
 
+    backend->health.record_success();
     const bool removed = *result;
     if (removed) {
       LOG("Removed {} from {} ({:.2f} ms)",
@@ -743,6 +937,139 @@ Storage::remove_from_remote_storage(const Hash::Digest& key)
   }
 }
 
+size_t
+Storage::fetch_into_local_storage(
+  std::span<const Hash::Digest> keys,
+  const uint32_t threads,
+  const local::ProgressReceiver& progress_receiver)
+{
+  using Backend = remote::RemoteStorage::Backend;
+
+  init_remote_storage();
+  discard_prefetch();
+
+  // Backends are not thread-safe, so each worker creates its own backend for
+  // each shard that it talks to. Statistics and the health of each shard are
+  // shared and protected by `mutex` while entries are verified and stored in
+  // local storage concurrently.
+  std::mutex mutex;
+  std::unordered_map<std::string /*url*/, BackendHealth> healths;
+  std::atomic<size_t> next_index = 0;
+  size_t completed = 0;
+  size_t fetched = 0;
+
+  // Assumes `mutex` is held.
+  const auto get_health = [&](const Url& url) -> BackendHealth& {
+    return healths
+      .try_emplace(url.str(), m_config.temporary_dir(), url.str())
+      .first->second;
+  };
+
+  // Assumes `mutex` is held.
+  const auto record_failure = [&](const Url& url, Backend::Failure failure) {
+    local.increment_statistic(failure == Backend::Failure::timeout
+                                ? core::Statistic::remote_storage_timeout
+                                : core::Statistic::remote_storage_error);
+    get_health(url).record_failure();
+  };
+
+  const auto worker = [&] {
+    std::unordered_map<std::string /*url*/, std::unique_ptr<Backend>> backends;
+
+    // Return nullptr if the shard is skipped since it has failed recently or
+    // if the backend can't be created.
+    const auto get_worker_backend = [&](const RemoteStorageEntry& entry,
+                                        const Url& url) -> Backend* {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (get_health(url).should_skip()) {
+          return nullptr;
+        }
+      }
+      auto& backend = backends[url.str()];
+      if (!backend) {
+        try {
+          backend = entry.storage->create_backend(url, entry.config.attributes);
+        } catch (const Backend::Failed& e) {
+          std::lock_guard<std::mutex> lock(mutex);
+          record_failure(url, e.failure());
+        }
+      }
+      return backend.get();
+    };
+
+    for (size_t i = next_index++; i < keys.size(); i = next_index++) {
+      const auto& key = keys[i];
+      if (!local.exists(key)) {
+        for (const auto& entry : m_remote_storages) {
+          const auto url = get_shard_url(key, entry->config.shards);
+          auto* backend = get_worker_backend(*entry, url);
+          if (!backend) {
+            continue;
+          }
+
+          auto result = backend->get(key);
+          bool valid = false;
+          if (result && *result && !(*result)->empty()) {
+            // Only store entries that a later get would accept.
+            try {
+              core::CacheEntry cache_entry(**result);
+              cache_entry.verify_checksum();
+              valid = true;
+            } catch (const core::Error& e) {
+              LOG("Ignoring invalid entry {} from {}: {}",
+                  util::format_base16(key),
+                  get_redacted_url_str_for_logging(url),
+                  e.what());
+            }
+          }
+          if (valid) {
+            local.put(key, **result, Overwrite::no);
+          }
+
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!result) {
+            record_failure(url, result.error());
+            // Create a new backend when the shard is tried again.
+            backends[url.str()].reset();
+            continue;
+          }
+          get_health(url).record_success();
+          if (valid) {
+            local.increment_statistic(core::Statistic::remote_storage_read_hit);
+            ++fetched;
+            break;
+          } else {
+            local.increment_statistic(
+              *result ? core::Statistic::remote_storage_error
+                      : core::Statistic::remote_storage_read_miss);
+          }
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      ++completed;
+      progress_receiver(static_cast<double>(completed)
+                        / static_cast<double>(keys.size()));
+    }
+  };
+
+  const auto worker_count =
+    std::clamp<size_t>(threads, 1, std::max<size_t>(keys.size(), 1));
+  util::ThreadPool thread_pool(worker_count);
+  std::vector<std::future<void>> futures;
+  futures.reserve(worker_count);
+  for (size_t i = 0; i < worker_count; ++i) {
+    futures.push_back(thread_pool.enqueue(worker));
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+  thread_pool.shut_down();
+
+  return fetched;
+}
+
 void
 Storage::stop_remote_storage_helpers()
 {
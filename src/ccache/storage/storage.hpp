@@ -21,6 +21,7 @@
 #include <ccache/core/types.hpp>
 #include <ccache/hash.hpp>
 #include <ccache/storage/local/localstorage.hpp>
+#include <ccache/storage/local/util.hpp>
 #include <ccache/storage/remote/remotestorage.hpp>
 #include <ccache/storage/types.hpp>
 #include <ccache/util/bytes.hpp>
@@ -42,8 +43,10 @@ constexpr auto k_redacted_secret = "********";
 
 std::vector<std::string> get_features();
 
+class FrequencySketch;
 struct RemoteStorageBackendEntry;
 struct RemoteStorageEntry;
+struct RemoteStoragePrefetch;
 
 std::string get_redacted_url_str_for_logging(const Url& url);
 
@@ -65,8 +68,29 @@ public:
 
   void put(const Hash::Digest& key, std::span<const uint8_t> value);
 
+  // Like put() but let `merger` compute the value from the currently stored
+  // value so that entries written concurrently by other processes are not
+  // lost. Merging is atomic for local storage. Remote storage has no atomic
+  // update operation, so it is only read back first in remote_only mode,
+  // which narrows but does not close the window for lost updates.
+  void merge(const Hash::Digest& key, const EntryMerger& merger);
+
+  // Start fetching `key` from remote storage in the background if it is not
+  // present in local storage. A later get() of the same key uses the
+  // prefetched value instead of sending a new request. The prefetched value is
+  // discarded if any other remote storage operation happens first.
+  void prefetch(const Hash::Digest& key);
+
   void remove(const Hash::Digest& key);
 
+  // Download `keys` that are missing in local storage from remote storage into
+  // local storage using up to `threads` parallel connections per remote
+  // storage. Returns the number of fetched entries.
+  size_t fetch_into_local_storage(
+    std::span<const Hash::Digest> keys,
+    uint32_t threads,
+    const local::ProgressReceiver& progress_receiver);
+
   void stop_remote_storage_helpers();
 
   std::string get_remote_storage_config_for_logging() const;
@@ -75,6 +99,10 @@ private:
   const Config& m_config;
   std::filesystem::path m_ccache_exe_dir;
   std::vector<std::unique_ptr<RemoteStorageEntry>> m_remote_storages;
+  // Declared after m_remote_storages so that a pending prefetch is finished
+  // before its backend is destroyed.
+  std::unique_ptr<RemoteStoragePrefetch> m_prefetch;
+  std::unique_ptr<FrequencySketch> m_frequency_sketch;
 
   void init_remote_storage();
 
@@ -86,10 +114,25 @@ private:
                                          std::string_view operation_description,
                                          const bool for_writing);
 
+  // Wait for a pending prefetch and return it if it is for `key`, otherwise
+  // discard it.
+  std::unique_ptr<RemoteStoragePrefetch> take_prefetch(const Hash::Digest& key);
+
+  void discard_prefetch();
+
+  // Return whether an entry of `size` bytes fetched from remote storage should
+  // be stored in local storage according to the remote_fill_policy option.
+  bool should_fill_local_storage(const Hash::Digest& key, size_t size);
+
   void get_from_remote_storage(const Hash::Digest& key,
                                core::CacheEntryType type,
                                const EntryReceiver& entry_receiver);
 
+  // Return the value of `key` from the first remote storage that has it,
+  // without counting it as a read hit or miss.
+  std::optional<util::Bytes>
+  get_from_remote_storage_for_merge(const Hash::Digest& key);
+
   void put_in_remote_storage(const Hash::Digest& key,
                              std::span<const uint8_t> value,
                              Overwrite overwrite);
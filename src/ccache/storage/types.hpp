@@ -18,13 +18,21 @@
 
 #pragma once
 
+#include <ccache/util/bytes.hpp>
+
 #include <functional>
+#include <optional>
 #include <string>
 
 namespace storage {
 
 using EntryWriter = std::function<bool(const std::string& path)>;
 
+// Called with the currently stored value of an entry, if any. Returns the value
+// to store, or std::nullopt to leave the entry unchanged.
+using EntryMerger =
+  std::function<std::optional<util::Bytes>(std::optional<util::Bytes>&&)>;
+
 enum class Overwrite {
   yes, // Overwrite any preexisting value
   no,  // OK to not overwrite any preexisting value (but OK to overwrite anyway)
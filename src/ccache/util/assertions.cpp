@@ -19,6 +19,7 @@
 #include <ccache/util/assertions.hpp>
 #include <ccache/util/filesystem.hpp>
 #include <ccache/util/format.hpp>
+#include <ccache/util/logging.hpp>
 
 namespace fs = util::filesystem;
 
@@ -36,6 +37,7 @@ handle_failed_assertion(const fs::path& file,
         line,
         function,
         condition);
+  util::logging::flush_signal_safe();
   abort();
 }
 
@@ -128,10 +128,18 @@ exec_to_string(const Args& args)
   CHECK_LIB_CALL(posix_spawn_file_actions_adddup2, &fa, pipefd[1], 1);
   CHECK_LIB_CALL(posix_spawn_file_actions_adddup2, &fa, pipefd[1], 2);
 
+  posix_spawnattr_t attr;
+  CHECK_LIB_CALL(posix_spawnattr_init, &attr);
+#ifdef POSIX_SPAWN_USEVFORK
+  // Avoid copying page tables with glibc < 2.24.
+  CHECK_LIB_CALL(posix_spawnattr_setflags, &attr, POSIX_SPAWN_USEVFORK);
+#endif
+
   pid_t pid;
   auto argv_mutable = const_cast<char* const*>(argv.data());
   int spawn_result =
-    posix_spawnp(&pid, argv[0], &fa, nullptr, argv_mutable, environ);
+    posix_spawnp(&pid, argv[0], &fa, &attr, argv_mutable, environ);
+  posix_spawnattr_destroy(&attr);
   posix_spawn_file_actions_destroy(&fa);
   close(pipefd[1]);
 
@@ -19,6 +19,7 @@
 
 #include <ccache/config.hpp>
 #include <ccache/util/file.hpp>
+#include <ccache/util/filelock.hpp>
 #include <ccache/util/filestream.hpp>
 #include <ccache/util/filesystem.hpp>
 #include <ccache/util/format.hpp>
@@ -26,6 +27,7 @@
 #include <ccache/util/string.hpp>
 #include <ccache/util/time.hpp>
 
+#include <cstdlib>
 #include <mutex>
 #include <string>
 
@@ -51,6 +53,16 @@ namespace {
 fs::path logfile_path;
 util::FileStream logfile;
 
+// Log lines not yet written to logfile. They are written with a single append
+// when the buffer is full, at exit, on fatal signals and failed assertions and
+// before executing another program, so concurrent ccache processes don't have
+// to lock and write the shared log file for each line.
+std::string logfile_buffer;
+
+// Write the buffer when it grows beyond this size. This bounds memory usage and
+// the number of lines lost if the process is killed.
+const size_t k_max_logfile_buffer_size = 64 * 1024;
+
 // Whether to use syslog() instead.
 bool use_syslog = false;
 
@@ -63,10 +75,9 @@ bool debug_log_enabled = false;
 // Mutex that serializes writes to logfile and protects debug_log_buffer.
 std::mutex log_mutex;
 
-// Print error message to stderr about failure writing to the log file and exit
-// with failure.
-[[noreturn]] void
-print_fatal_error_and_exit()
+// Print error message to stderr about failure writing to the log file.
+void
+print_error()
 {
   // Note: Can't throw Fatal since that would lead to recursion.
   try {
@@ -77,9 +88,37 @@ print_fatal_error_and_exit()
   } catch (std::runtime_error&) { // NOLINT: this is deliberate
     // Ignore since we can't do anything about it.
   }
+}
+
+// Print error message to stderr about failure writing to the log file and exit
+// with failure.
+[[noreturn]] void
+print_fatal_error_and_exit()
+{
+  print_error();
   exit(EXIT_FAILURE);
 }
 
+// Write and clear logfile_buffer. Returns false on failure.
+//
+// Assumes log_mutex is already held.
+bool
+write_logfile_buffer()
+{
+  if (!logfile || logfile_buffer.empty()) {
+    return true;
+  }
+
+  // Clear the buffer before writing so that a failure isn't repeated by the
+  // flush at exit.
+  const auto buffer = std::move(logfile_buffer);
+  logfile_buffer.clear();
+
+  util::FileLock file_lock(fileno(*logfile));
+  std::ignore = file_lock.acquire(); // Continue anyway on failure
+  return bool(util::write_fd(fileno(*logfile), buffer.data(), buffer.size()));
+}
+
 void
 format_prefix(char* buffer, size_t size)
 {
@@ -92,17 +131,21 @@ format_prefix(char* buffer, size_t size)
                  static_cast<int>(getpid()));
 }
 
-// Write log entry to all enabled destinations.
+// Write log entry to all enabled destinations. Returns false if writing to
+// the log file failed, in which case the caller should release log_mutex and
+// call print_fatal_error_and_exit.
 //
-// Assumes log_mutex is already held and file_lock is acquired if needed.
-void
+// Assumes log_mutex is already held.
+bool
 write_log_entry(const char* prefix, std::string_view message)
 {
+  bool success = true;
   if (logfile) {
-    if (fputs(prefix, *logfile) == EOF
-        || fwrite(message.data(), message.length(), 1, *logfile) != 1
-        || fputc('\n', *logfile) == EOF || fflush(*logfile) == EOF) {
-      print_fatal_error_and_exit();
+    logfile_buffer += prefix;
+    logfile_buffer.append(message.data(), message.length());
+    logfile_buffer += '\n';
+    if (logfile_buffer.size() >= k_max_logfile_buffer_size) {
+      success = write_logfile_buffer();
     }
   }
 #ifdef HAVE_SYSLOG
@@ -118,6 +161,7 @@ write_log_entry(const char* prefix, std::string_view message)
     debug_log_buffer.append(message.data(), message.length());
     debug_log_buffer += '\n';
   }
+  return success;
 }
 
 } // namespace
@@ -143,6 +187,11 @@ init(bool debug, const fs::path& log_file)
     logfile.open(logfile_path, "a");
     if (logfile) {
       util::set_cloexec_flag(fileno(*logfile));
+      static bool flush_registered = false;
+      if (!flush_registered) {
+        std::atexit(flush);
+        flush_registered = true;
+      }
     } else {
       print_fatal_error_and_exit();
     }
@@ -166,14 +215,39 @@ log(std::string_view message)
   format_prefix(prefix, sizeof(prefix));
 
   std::unique_lock<std::mutex> lock(log_mutex);
+  if (!write_log_entry(prefix, message)) {
+    // Release the mutex since exit calls flush.
+    lock.unlock();
+    print_fatal_error_and_exit();
+  }
+}
 
-  std::optional<util::FileLock> file_lock;
-  if (logfile) {
-    file_lock.emplace(fileno(*logfile));
-    std::ignore = file_lock->acquire(); // Continue anyway on failure
+void
+flush()
+{
+  std::unique_lock<std::mutex> lock(log_mutex);
+  if (!write_logfile_buffer()) {
+    print_error();
   }
+}
 
-  write_log_entry(prefix, message);
+void
+flush_signal_safe()
+{
+  // Don't wait for the mutex since the interrupted code may be holding it.
+  if (!log_mutex.try_lock()) {
+    return;
+  }
+  if (logfile && !logfile_buffer.empty()) {
+    // Write the buffer in place since write_logfile_buffer frees it, which is
+    // not signal safe.
+    util::FileLock file_lock(fileno(*logfile));
+    std::ignore = file_lock.acquire(); // Continue anyway on failure
+    std::ignore = util::write_fd(
+      fileno(*logfile), logfile_buffer.data(), logfile_buffer.size());
+    logfile_buffer.clear();
+  }
+  log_mutex.unlock();
 }
 
 void
@@ -196,13 +270,9 @@ BulkLogger::BulkLogger()
     // Compute and cache prefix once for all bulk logs.
     format_prefix(m_prefix, sizeof(m_prefix));
 
-    // Acquire both locks: mutex for in-process sync, file lock for
-    // inter-process.
+    // Lines are buffered and written to the log file in one go, so only the
+    // in-process mutex is needed.
     m_mutex_lock = std::unique_lock<std::mutex>(log_mutex);
-    if (logfile) {
-      m_file_lock.emplace(fileno(*logfile));
-      std::ignore = m_file_lock->acquire(); // Continue anyway on failure
-    }
   }
 }
 
@@ -213,7 +283,11 @@ BulkLogger::log(std::string_view message)
     return;
   }
 
-  write_log_entry(m_prefix, message);
+  if (!write_log_entry(m_prefix, message)) {
+    // Release the mutex since exit calls flush.
+    m_mutex_lock.unlock();
+    print_fatal_error_and_exit();
+  }
 }
 
 } // namespace util::logging
@@ -18,14 +18,11 @@
 
 #pragma once
 
-#include <ccache/util/filelock.hpp>
-
 #include <fmt/core.h>
 #include <fmt/format.h>
 
 #include <filesystem>
 #include <mutex>
-#include <optional>
 #include <string_view>
 
 // Log a message (plus a newline character).
@@ -36,8 +33,7 @@
     }                                                                          \
   } while (false)
 
-// Log a message (plus a newline character) without flushing and with a reused
-// timestamp.
+// Log a message (plus a newline character) with a reused timestamp.
 #define BULK_LOG(logger_, format_, ...)                                        \
   logger_.log(fmt::format(format_ __VA_OPT__(, ) __VA_ARGS__))
 
@@ -51,8 +47,20 @@ void init(bool debug, const std::filesystem::path& log_file);
 bool enabled();
 
 // Log `message` (plus a newline character).
+//
+// Messages to the log file are buffered in memory and written by flush, which
+// is called automatically at exit and when the buffer is full, or by
+// flush_signal_safe.
 void log(std::string_view message);
 
+// Write buffered messages to the log file. Call before replacing the process
+// with exec.
+void flush();
+
+// Like flush but safe to call from a signal handler or when aborting. Nothing
+// is written if the log is in use, e.g. by the interrupted code.
+void flush_signal_safe();
+
 // Write the current log memory buffer to `path`.
 void dump_log(const std::filesystem::path& path);
 
@@ -66,7 +74,6 @@ public:
 
 private:
   std::unique_lock<std::mutex> m_mutex_lock;
-  std::optional<util::FileLock> m_file_lock;
   char m_prefix[200] = {};
 };
 
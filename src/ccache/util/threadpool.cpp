@@ -21,6 +21,7 @@
 #include <ccache/util/logging.hpp>
 
 #include <algorithm>
+#include <exception>
 
 namespace util {
 
@@ -32,6 +33,9 @@ namespace {
 // workers try to enqueue while the queue is full.
 thread_local ThreadPool* t_current_pool = nullptr;
 
+// Index of the current worker thread in t_current_pool.
+thread_local size_t t_worker_index = 0;
+
 void
 execute_task(const std::function<void()>& task, const char* context)
 {
@@ -49,9 +53,13 @@ ThreadPool::ThreadPool(size_t number_of_threads, size_t task_queue_max_size)
   : m_task_queue_max_size(task_queue_max_size)
 {
   size_t actual_threads = std::max<size_t>(1, number_of_threads);
+  m_task_queues.reserve(actual_threads);
+  for (size_t i = 0; i < actual_threads; ++i) {
+    m_task_queues.push_back(std::make_unique<TaskQueue>());
+  }
   m_worker_threads.reserve(actual_threads);
   for (size_t i = 0; i < actual_threads; ++i) {
-    m_worker_threads.emplace_back(&ThreadPool::worker_thread_main, this);
+    m_worker_threads.emplace_back(&ThreadPool::worker_thread_main, this, i);
   }
 }
 
@@ -63,38 +71,100 @@ ThreadPool::~ThreadPool() noexcept
 void
 ThreadPool::enqueue_detach(std::function<void()> function)
 {
-  // Fast path for worker threads: avoid blocking on a full queue to prevent
-  // deadlocks (all workers waiting inside enqueue() means no one can pop).
-  std::function<void()> inline_task;
-  {
-    std::unique_lock<std::mutex> lock(m_mutex);
+  enqueue_tasks(std::span(&function, 1));
+}
 
-    if (m_shutting_down) {
-      return;
+void
+ThreadPool::enqueue_detach(std::vector<std::function<void()>> functions)
+{
+  enqueue_tasks(functions);
+}
+
+void
+ThreadPool::enqueue_tasks(std::span<std::function<void()>> functions)
+{
+  // Worker threads don't block on a full queue to prevent deadlocks (all
+  // workers waiting inside enqueue() means no one can pop). They execute the
+  // task inline instead.
+  const bool in_worker = t_current_pool == this;
+
+  auto remaining = functions;
+  while (!remaining.empty() && !m_shutting_down) {
+    const size_t reserved = reserve(remaining.size(), !in_worker);
+    if (reserved > 0) {
+      push_reserved(remaining.first(reserved));
+      remaining = remaining.subspan(reserved);
+    } else if (in_worker && !m_shutting_down) {
+      execute_task(remaining.front(), "inline");
+      remaining = remaining.subspan(1);
     }
+  }
+}
 
-    // If called from a worker thread belonging to this pool and the queue is
-    // full, execute the task inline instead of blocking.
-    if (t_current_pool == this
-        && m_task_queue.size() >= m_task_queue_max_size) {
-      inline_task = std::move(function);
-    } else {
-      if (m_task_queue.size() >= m_task_queue_max_size) {
-        m_producer_cv.wait(lock, [this] {
-          return m_shutting_down || m_task_queue.size() < m_task_queue_max_size;
-        });
+void
+ThreadPool::parallel_for(size_t begin,
+                         size_t end,
+                         const std::function<void(size_t index)>& function,
+                         size_t chunk_size)
+{
+  if (begin >= end) {
+    return;
+  }
+  chunk_size = std::max<size_t>(1, chunk_size);
+  const size_t chunks = (end - begin + chunk_size - 1) / chunk_size;
+
+  struct State
+  {
+    std::atomic<size_t> next_chunk = 0;
+    std::atomic<size_t> finished_chunks = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr exception;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+  auto state = std::make_shared<State>();
+
+  // Helper tasks that start after all chunks have been claimed return without
+  // touching `function`, so they may outlive this call.
+  auto process_chunks = [state, &function, begin, end, chunk_size, chunks] {
+    size_t chunk;
+    while ((chunk = state->next_chunk++) < chunks) {
+      if (!state->failed) {
+        try {
+          const size_t chunk_begin = begin + chunk * chunk_size;
+          const size_t chunk_end = std::min(end, chunk_begin + chunk_size);
+          for (size_t i = chunk_begin; i < chunk_end; ++i) {
+            function(i);
+          }
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if (!state->failed.exchange(true)) {
+            state->exception = std::current_exception();
+          }
+        }
       }
-      if (m_shutting_down) {
-        return;
+      if (++state->finished_chunks == chunks) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->cv.notify_all();
       }
-      m_task_queue.emplace(std::move(function));
-      // Wake a worker to process the enqueued task.
-      m_worker_cv.notify_one();
     }
+  };
+
+  // Helpers are optional since the calling thread processes chunks too, so
+  // don't wait for room in the queue.
+  if (!m_shutting_down) {
+    const size_t helpers =
+      reserve(std::min(chunks - 1, m_worker_threads.size()), false);
+    std::vector<std::function<void()>> helper_tasks(helpers, process_chunks);
+    push_reserved(helper_tasks);
   }
 
-  if (inline_task) {
-    execute_task(inline_task, "inline");
+  process_chunks();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&] { return state->finished_chunks == chunks; });
+  if (state->exception) {
+    std::rethrow_exception(state->exception);
   }
 }
 
@@ -118,31 +188,130 @@ ThreadPool::shut_down() noexcept
   }
 }
 
+size_t
+ThreadPool::reserve(size_t count, bool wait)
+{
+  while (true) {
+    size_t queued = m_queued_tasks;
+    while (queued < m_task_queue_max_size) {
+      const size_t n = std::min(count, m_task_queue_max_size - queued);
+      if (m_queued_tasks.compare_exchange_weak(queued, queued + n)) {
+        // Checking after reserving guarantees that a worker exiting due to
+        // shut_down either sees the reservation or that we see the flag.
+        if (m_shutting_down) {
+          m_queued_tasks -= n;
+          return 0;
+        }
+        return n;
+      }
+    }
+    if (!wait || m_shutting_down) {
+      return 0;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_waiting_producers;
+    m_producer_cv.wait(lock, [this] {
+      return m_shutting_down || m_queued_tasks < m_task_queue_max_size;
+    });
+    --m_waiting_producers;
+  }
+}
+
 void
-ThreadPool::worker_thread_main()
+ThreadPool::push_reserved(std::span<std::function<void()>> functions)
+{
+  if (functions.empty()) {
+    return;
+  }
+
+  // Tasks enqueued by a worker go to its own queue first to keep related work
+  // on the same thread. Other tasks are spread evenly, starting round-robin.
+  const size_t queue_count = m_task_queues.size();
+  const size_t first_queue = t_current_pool == this
+                               ? t_worker_index
+                               : m_next_queue++ % queue_count;
+  const size_t per_queue = (functions.size() + queue_count - 1) / queue_count;
+  for (size_t i = 0; !functions.empty(); ++i) {
+    const size_t n = std::min(per_queue, functions.size());
+    auto& queue = *m_task_queues[(first_queue + i) % queue_count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    for (auto& function : functions.first(n)) {
+      queue.tasks.push_back(std::move(function));
+    }
+    functions = functions.subspan(n);
+  }
+
+  // Idle workers wait for m_queued_tasks to become nonzero while holding
+  // m_mutex, so taking it here guarantees that the notification isn't lost.
+  if (m_idle_workers > 0) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_worker_cv.notify_all();
+  }
+}
+
+std::function<void()>
+ThreadPool::pop(size_t worker_index)
+{
+  std::function<void()> task;
+
+  // Take the oldest task from the worker's own queue or else steal the newest
+  // task from another queue.
+  const size_t queue_count = m_task_queues.size();
+  for (size_t i = 0; i < queue_count && !task; ++i) {
+    auto& queue = *m_task_queues[(worker_index + i) % queue_count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+  }
+
+  if (task) {
+    --m_queued_tasks;
+    // Notify any threads blocked in enqueue() that space is now available.
+    if (m_waiting_producers > 0) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_producer_cv.notify_all();
+    }
+  }
+  return task;
+}
+
+void
+ThreadPool::worker_thread_main(size_t worker_index)
 {
   // Mark the current thread as a worker of this pool for the duration of its
   // lifetime to allow enqueue() to detect re-entrancy safely.
   t_current_pool = this;
+  t_worker_index = worker_index;
   while (true) {
-    std::function<void()> task;
-
-    {
-      std::unique_lock<std::mutex> lock(m_mutex);
-      m_worker_cv.wait(
-        lock, [this] { return m_shutting_down || !m_task_queue.empty(); });
-      if (m_shutting_down && m_task_queue.empty()) {
-        return;
-      }
-      task = std::move(m_task_queue.front());
-      m_task_queue.pop();
-      // Notify any threads blocked in enqueue() that space is now available.
-      // Notifying while holding the lock ensures the waiting thread sees the
-      // updated queue size immediately upon waking.
-      m_producer_cv.notify_one();
+    if (auto task = pop(worker_index)) {
+      execute_task(task, "worker");
+      continue;
     }
 
-    execute_task(task, "worker");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Check the flag before the count; see reserve().
+    if (m_shutting_down && m_queued_tasks == 0) {
+      return;
+    }
+    if (m_queued_tasks > 0) {
+      // A task has been reserved but not yet pushed to a queue.
+      lock.unlock();
+      std::this_thread::yield();
+      continue;
+    }
+    ++m_idle_workers;
+    m_worker_cv.wait(
+      lock, [this] { return m_shutting_down || m_queued_tasks > 0; });
+    --m_idle_workers;
   }
 }
 
@@ -20,14 +20,16 @@
 
 #include <ccache/util/noncopyable.hpp>
 
+#include <atomic>
 #include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <future>
 #include <limits>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <span>
 #include <thread>
 #include <type_traits>
 #include <utility>
@@ -35,9 +37,18 @@
 
 namespace util {
 
+// A work-stealing thread pool. Each worker has a task queue of its own that it
+// takes tasks from in FIFO order. Workers with an empty queue steal tasks from
+// the back of the other workers' queues, so workers only contend for a lock
+// when they operate on the same queue. Tasks enqueued from outside the pool are
+// distributed over the queues round-robin while tasks enqueued by a worker are
+// put in its own queue.
 class ThreadPool : util::NonCopyable
 {
 public:
+  // `task_queue_max_size` is the maximum number of queued (not yet started)
+  // tasks in total. Enqueueing blocks while the limit is reached, except in
+  // worker threads, which execute the task inline instead.
   explicit ThreadPool(
     size_t number_of_threads,
     size_t task_queue_max_size = std::numeric_limits<size_t>::max());
@@ -45,24 +56,64 @@ public:
 
   void enqueue_detach(std::function<void()> function);
 
+  // Enqueue several tasks at once, taking each queue lock only once.
+  void enqueue_detach(std::vector<std::function<void()>> functions);
+
   // Enqueue a task that returns a value. Returns a std::future that can be
   // used to retrieve the result once the task completes.
   template<typename F, typename... Args>
   auto enqueue(F&& f, Args&&... args)
     -> std::future<typename std::invoke_result_t<F, Args...>>;
 
+  // Call `function` for each index in [`begin`, `end`) and return when all
+  // calls have finished. The range is split into chunks of `chunk_size`
+  // indexes that are processed by the workers and the calling thread, so it's
+  // safe to call from a worker thread. If a call throws, the remaining chunks
+  // are skipped and the exception is rethrown.
+  void parallel_for(size_t begin,
+                    size_t end,
+                    const std::function<void(size_t index)>& function,
+                    size_t chunk_size = 1);
+
   void shut_down() noexcept;
 
 private:
+  struct TaskQueue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<TaskQueue>> m_task_queues;
   std::vector<std::thread> m_worker_threads;
-  std::queue<std::function<void()>> m_task_queue;
   size_t m_task_queue_max_size;
-  bool m_shutting_down = false;
+
+  // Number of queued tasks, including tasks that have been reserved a place
+  // but not yet pushed to a queue.
+  std::atomic<size_t> m_queued_tasks = 0;
+  std::atomic<size_t> m_next_queue = 0;
+  std::atomic<bool> m_shutting_down = false;
+
+  // Used for sleeping when there is no work or the queue limit is reached.
   std::mutex m_mutex;
   std::condition_variable m_worker_cv;
   std::condition_variable m_producer_cv;
+  std::atomic<size_t> m_idle_workers = 0;
+  std::atomic<size_t> m_waiting_producers = 0;
+
+  void enqueue_tasks(std::span<std::function<void()>> functions);
+
+  // Reserve places for up to `count` tasks. Returns the number of reserved
+  // places, which is 0 if the pool is shutting down or if the queue is full and
+  // `wait` is false.
+  size_t reserve(size_t count, bool wait);
+
+  // Distribute `functions`, for which places have been reserved, over the task
+  // queues and wake up workers.
+  void push_reserved(std::span<std::function<void()>> functions);
 
-  void worker_thread_main();
+  std::function<void()> pop(size_t worker_index);
+  void worker_thread_main(size_t worker_index);
 };
 
 template<typename F, typename... Args>
@@ -0,0 +1,52 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "throttle.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace util {
+
+Throttle::Throttle(const uint64_t rate)
+  : m_rate(rate)
+{
+}
+
+void
+Throttle::consume(const uint64_t amount)
+{
+  if (m_rate == 0) {
+    return;
+  }
+
+  using namespace std::chrono;
+
+  steady_clock::time_point start;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    start = std::max(m_next_start, steady_clock::now());
+    m_next_start =
+      start
+      + duration_cast<steady_clock::duration>(duration<double>(
+        static_cast<double>(amount) / static_cast<double>(m_rate)));
+  }
+  std::this_thread::sleep_until(start);
+}
+
+} // namespace util
@@ -0,0 +1,48 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#pragma once
+
+#include <ccache/util/noncopyable.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace util {
+
+// Limit the average rate of some quantity, e.g. bytes read and written by a
+// maintenance operation, by making callers sleep. Can be shared between
+// threads.
+class Throttle : util::NonCopyable
+{
+public:
+  // `rate` is the maximum amount per second, 0 for no limit.
+  explicit Throttle(uint64_t rate);
+
+  // Account for `amount` about to be consumed. Sleeps until the amounts
+  // consumed earlier fit within the rate limit.
+  void consume(uint64_t amount);
+
+private:
+  const uint64_t m_rate;
+  std::chrono::steady_clock::time_point m_next_start;
+  std::mutex m_mutex;
+};
+
+} // namespace util
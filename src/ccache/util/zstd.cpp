@@ -18,8 +18,66 @@
 
 #include "zstd.hpp"
 
+#include <ccache/util/assertions.hpp>
+#include <ccache/util/format.hpp>
+#include <ccache/util/timer.hpp>
+
 #include <zstd.h>
 
+namespace {
+
+// Inputs smaller than this are always compressed with level 1 since the
+// absolute gain of a higher level is negligible.
+const size_t k_adaptive_min_input_size = 256 * 1024;
+
+// Size of the input sample compressed to measure speed and ratio.
+const size_t k_adaptive_sample_size = 64 * 1024;
+
+// Write bandwidth assumed when nothing has been measured yet, roughly that of
+// a local disk.
+const double k_default_write_bandwidth = 500e6;
+
+struct LevelProfile
+{
+  int8_t level;
+  double relative_speed; // Compression speed relative to level 1
+  double relative_size;  // Compressed size relative to level 1
+};
+
+// Skippable frame fields are little-endian, unlike other integers in ccache's
+// formats.
+
+void
+write_little_endian_uint32(util::Bytes& output, uint32_t value)
+{
+  for (size_t i = 0; i < 4; ++i) {
+    output.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+uint32_t
+read_little_endian_uint32(const uint8_t* data)
+{
+  uint32_t value = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+// Approximate characteristics of Zstandard levels for typical object files.
+const LevelProfile k_level_profiles[] = {
+  {1, 1.0, 1.0},
+  {3, 0.7, 0.92},
+  {6, 0.25, 0.87},
+  {9, 0.16, 0.85},
+  {12, 0.08, 0.83},
+  {15, 0.03, 0.81},
+  {19, 0.006, 0.78},
+};
+
+} // namespace
+
 namespace util {
 
 tl::expected<void, std::string>
@@ -67,6 +125,47 @@ zstd_decompress(std::span<const uint8_t> input,
   return {};
 }
 
+tl::expected<void, std::string>
+zstd_decompress(std::span<const uint8_t> input, std::span<uint8_t> output)
+{
+  const size_t ret =
+    ZSTD_decompress(output.data(), output.size(), input.data(), input.size());
+  if (ZSTD_isError(ret)) {
+    return tl::unexpected(ZSTD_getErrorName(ret));
+  }
+  if (ret != output.size()) {
+    return tl::unexpected(
+      FMT("decompressed {} bytes, expected {}", ret, output.size()));
+  }
+  return {};
+}
+
+void
+zstd_write_skippable_frame(Bytes& output,
+                           uint8_t variant,
+                           std::span<const uint8_t> content)
+{
+  ASSERT(variant <= 0xf);
+  write_little_endian_uint32(output, ZSTD_MAGIC_SKIPPABLE_START | variant);
+  write_little_endian_uint32(output, static_cast<uint32_t>(content.size()));
+  output.insert(output.end(), content);
+}
+
+std::optional<std::span<const uint8_t>>
+zstd_read_skippable_frame(std::span<const uint8_t> input, uint8_t variant)
+{
+  if (input.size() < k_zstd_skippable_frame_header_size
+      || read_little_endian_uint32(input.data())
+           != (ZSTD_MAGIC_SKIPPABLE_START | variant)) {
+    return std::nullopt;
+  }
+  const uint32_t size = read_little_endian_uint32(input.data() + 4);
+  if (size > input.size() - k_zstd_skippable_frame_header_size) {
+    return std::nullopt;
+  }
+  return input.subspan(k_zstd_skippable_frame_header_size, size);
+}
+
 size_t
 zstd_compress_bound(size_t input_size)
 {
@@ -85,4 +184,67 @@ zstd_supported_compression_level(int8_t wanted_level)
   return {level, {}};
 }
 
+int8_t
+zstd_adaptive_compression_level(std::span<const uint8_t> input,
+                                double write_bandwidth)
+{
+  if (input.size() < k_adaptive_min_input_size) {
+    return 1;
+  }
+
+  const auto sample = input.first(k_adaptive_sample_size);
+  Bytes compressed_sample;
+  Timer timer;
+  if (!zstd_compress(sample, compressed_sample, 1)) {
+    return 1;
+  }
+  const double elapsed = timer.measure_s();
+  if (elapsed <= 0) {
+    return 1;
+  }
+
+  return zstd_adaptive_compression_level(
+    input.size(),
+    static_cast<double>(sample.size()) / elapsed,
+    static_cast<double>(compressed_sample.size())
+      / static_cast<double>(sample.size()),
+    write_bandwidth);
+}
+
+int8_t
+zstd_adaptive_compression_level(uint64_t input_size,
+                                double level_1_speed,
+                                double level_1_ratio,
+                                double write_bandwidth)
+{
+  if (input_size < k_adaptive_min_input_size || level_1_speed <= 0) {
+    return 1;
+  }
+  if (level_1_ratio > 0.95) {
+    return 1; // Higher levels won't help much for incompressible data.
+  }
+  if (write_bandwidth <= 0) {
+    write_bandwidth = k_default_write_bandwidth;
+  }
+
+  const auto size = static_cast<double>(input_size);
+  int8_t best_level = 1;
+  double best_cost = 0;
+  for (const auto& profile : k_level_profiles) {
+    if (profile.level > ZSTD_maxCLevel()) {
+      break;
+    }
+    const double compress_time =
+      size / (level_1_speed * profile.relative_speed);
+    const double write_time =
+      size * level_1_ratio * profile.relative_size / write_bandwidth;
+    const double cost = compress_time + write_time;
+    if (profile.level == 1 || cost < best_cost) {
+      best_level = profile.level;
+      best_cost = cost;
+    }
+  }
+  return best_level;
+}
+
 } // namespace util
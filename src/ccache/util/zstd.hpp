@@ -24,6 +24,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <span>
 #include <string>
 #include <tuple>
@@ -36,9 +37,45 @@ namespace util {
 [[nodiscard]] tl::expected<void, std::string> zstd_decompress(
   std::span<const uint8_t> input, Bytes& output, size_t original_size);
 
+// Decompress `input` into `output`, which must be exactly as large as the
+// decompressed data.
+[[nodiscard]] tl::expected<void, std::string>
+zstd_decompress(std::span<const uint8_t> input, std::span<uint8_t> output);
+
+// Size of the magic number and frame size fields of a skippable frame.
+const size_t k_zstd_skippable_frame_header_size = 8;
+
+// Append a skippable frame with `content` to `output`. Decompressors ignore
+// skippable frames. `variant` (0-15) is the variable part of the magic number,
+// which lets readers recognize their own frames.
+void zstd_write_skippable_frame(Bytes& output,
+                                uint8_t variant,
+                                std::span<const uint8_t> content);
+
+// Return the content of the skippable frame with magic number variant
+// `variant` at the start of `input`, or std::nullopt if there is no such frame.
+std::optional<std::span<const uint8_t>>
+zstd_read_skippable_frame(std::span<const uint8_t> input, uint8_t variant);
+
 size_t zstd_compress_bound(size_t input_size);
 
 std::tuple<int8_t, std::string>
 zstd_supported_compression_level(int8_t wanted_level);
 
+// Choose a compression level for `input` that minimizes the estimated time to
+// compress it and write the compressed data to storage with a bandwidth of
+// `write_bandwidth` bytes per second (0 if unknown). Compression speed and
+// ratio are estimated by compressing a sample of `input`. Small inputs always
+// get level 1.
+int8_t zstd_adaptive_compression_level(std::span<const uint8_t> input,
+                                       double write_bandwidth);
+
+// Like above but with `level_1_speed` (uncompressed bytes per second) and
+// `level_1_ratio` (compressed size divided by uncompressed size) already
+// measured at compression level 1.
+int8_t zstd_adaptive_compression_level(uint64_t input_size,
+                                       double level_1_speed,
+                                       double level_1_ratio,
+                                       double write_bandwidth);
+
 } // namespace util
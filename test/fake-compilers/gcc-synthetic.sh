@@ -0,0 +1,134 @@
+#!/bin/bash
+#
+# A minimal GCC-like compiler used by benchmark/e2e-benchmark. It understands
+# just enough for ccache's preprocessor, direct and depend modes: -E, -c, -o,
+# -I, -MD/-MMD and -MF. Quoted includes are expanded recursively and the
+# "object file" is the preprocessed output, so compiling is cheap and the cache
+# entries have realistic sizes.
+
+preprocess=false
+output=
+depfile=
+write_depfile=false
+input=
+include_dirs=()
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -E)
+            preprocess=true
+            ;;
+        -o)
+            output=$2
+            shift
+            ;;
+        -MF)
+            depfile=$2
+            shift
+            ;;
+        -MD|-MMD)
+            write_depfile=true
+            ;;
+        -I)
+            include_dirs+=("$2")
+            shift
+            ;;
+        -I*)
+            include_dirs+=("${1#-I}")
+            ;;
+        -*)
+            ;;
+        *)
+            input=$1
+            ;;
+    esac
+    shift
+done
+
+if [ -z "$input" ]; then
+    echo "gcc-synthetic.sh: no input file" >&2
+    exit 1
+fi
+
+include_path=$(printf '%s\n' "${include_dirs[@]}")
+
+# Expand quoted includes recursively and write the result to stdout. If $1 is
+# not empty, also write a dependency file there.
+expand() {
+    awk -v include_path="$include_path" -v depfile="$1" -v target="$output" '
+        function dir_of(path) {
+            return sub(/\/[^\/]*$/, "", path) ? path : "."
+        }
+        function find_include(name, includer,    dirs, n, i, candidate) {
+            n = split(dir_of(includer) "\n" include_path, dirs, "\n")
+            for (i = 1; i <= n; ++i) {
+                if (dirs[i] == "") {
+                    continue
+                }
+                candidate = dirs[i] "/" name
+                if ((getline line < candidate) >= 0) {
+                    close(candidate)
+                    return candidate
+                }
+            }
+            return ""
+        }
+        function expand(file,    line_number, line, name, header) {
+            print "# 1 \"" file "\""
+            line_number = 0
+            while ((getline line < file) > 0) {
+                ++line_number
+                if (line ~ /^#include "[^"]+"/) {
+                    name = line
+                    sub(/^#include "/, "", name)
+                    sub(/".*/, "", name)
+                    header = find_include(name, file)
+                    if (header == "") {
+                        printf "%s:%d: %s: No such file\n",
+                               file, line_number, name > "/dev/stderr"
+                        exit 1
+                    }
+                    if (depfile != "") {
+                        printf " %s", header > depfile
+                    }
+                    expand(header)
+                    print "# " (line_number + 1) " \"" file "\""
+                } else {
+                    print line
+                }
+            }
+            close(file)
+        }
+        BEGIN {
+            if (depfile != "") {
+                printf "%s: %s", target, ARGV[1] > depfile
+            }
+            expand(ARGV[1])
+            if (depfile != "") {
+                print "" > depfile
+            }
+        }
+    ' "$input"
+}
+
+if $preprocess; then
+    if [ -n "$output" ]; then
+        expand "" >"$output"
+    else
+        expand ""
+    fi
+    exit
+fi
+
+if [ -z "$output" ]; then
+    output=$(basename "${input%.*}").o
+fi
+
+if $write_depfile; then
+    if [ -z "$depfile" ]; then
+        depfile=${output%.*}.d
+    fi
+    expand "$depfile" >"$output"
+else
+    expand "" >"$output"
+fi
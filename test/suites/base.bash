@@ -1334,6 +1334,32 @@ if ! $HOST_OS_WINDOWS; then
     expect_stat preprocessed_cache_hit 1
     expect_stat cache_miss 1
 fi
+
+    # -------------------------------------------------------------------------
+    TEST "CCACHE_SKIPUNCHANGED"
+
+    $CCACHE_COMPILE -MMD -c test1.c
+    expect_stat cache_miss 1
+    ln test1.o test1.o.saved
+    backdate test1.o test1.d
+
+    CCACHE_SKIPUNCHANGED=1 $CCACHE_COMPILE -MMD -c test1.c
+    expect_stat preprocessed_cache_hit 1
+    if [ ! test1.o -ef test1.o.saved ]; then
+        test_failed "test1.o was rewritten"
+    fi
+    expect_newer_than test1.o test1.c
+    expect_newer_than test1.d test1.c
+
+    echo garbage >test1.o
+    CCACHE_SKIPUNCHANGED=1 $CCACHE_COMPILE -MMD -c test1.c
+    expect_stat preprocessed_cache_hit 2
+    if [ test1.o -ef test1.o.saved ]; then
+        test_failed "test1.o was not rewritten"
+    fi
+    $COMPILER -c -o reference_test1.o test1.c
+    expect_equal_object_files reference_test1.o test1.o
+
     # -------------------------------------------------------------------------
 
     mkdir dir
@@ -2035,6 +2061,36 @@ if ! $HOST_OS_WINDOWS; then
     expect_content uncached_err_fd.txt ""
 fi
 
+    # -------------------------------------------------------------------------
+    TEST "Log file is written before falling back to the original command"
+
+    $CCACHE $COMPILER --version >/dev/null
+    expect_contains $CCACHE_LOGFILE "falling back to running the real compiler"
+    expect_contains $CCACHE_LOGFILE "Executing "
+
+if ! $HOST_OS_WINDOWS; then
+    # -------------------------------------------------------------------------
+    TEST "Log file is written when killed"
+
+    cat >compiler.sh <<EOF
+#!/bin/sh
+touch compiler.started
+sleep 10
+exec $COMPILER "\$@"
+EOF
+    chmod +x compiler.sh
+    CCACHE_LOGFILE=$PWD/killed.log $CCACHE ./compiler.sh -c test1.c &
+    pid=$!
+    for ((i = 0; i < 100; ++i)); do
+        [ -e compiler.started ] && break
+        sleep 0.1
+    done
+    kill -TERM $pid
+    wait $pid
+    expect_contains killed.log "Command line: "
+    expect_missing test1.o
+fi
+
     # -------------------------------------------------------------------------
     TEST "Invalid boolean environment configuration options"
 
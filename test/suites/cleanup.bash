@@ -145,4 +145,103 @@ SUITE_cleanup() {
     backdate $CCACHE_DIR/a/a/nowR
     $CCACHE --evict-older-than 10s  >/dev/null
     expect_stat files_in_cache 0
+
+    # -------------------------------------------------------------------------
+    TEST "Resumed eviction"
+
+    # Pretend that an interrupted eviction has processed directory 0/0.
+    printf 'evict 86400 -\n%s\n00\n' $(date +%s) \
+        >$CCACHE_DIR/evict.checkpoint
+    $CCACHE --evict-older-than 1d >evict.out
+    expect_contains evict.out "Resuming interrupted operation (1 of 256"
+    expect_file_count 10 '*R' $CCACHE_DIR
+    expect_missing $CCACHE_DIR/evict.checkpoint
+
+    # A checkpoint older than the age limit is ignored.
+    printf 'evict 86400 -\n%s\n00\n' $(($(date +%s) - 2 * 86400)) \
+        >$CCACHE_DIR/evict.checkpoint
+    $CCACHE --evict-older-than 1d >evict.out
+    expect_not_contains evict.out "Resuming"
+    expect_file_count 0 '*R' $CCACHE_DIR
+
+    # Clearing the cache removes checkpoints.
+    printf 'recompress 1\n%s\n00\n' $(date +%s) \
+        >$CCACHE_DIR/recompress.checkpoint
+    $CCACHE -C >/dev/null
+    expect_missing $CCACHE_DIR/recompress.checkpoint
+
+    # -------------------------------------------------------------------------
+    TEST "Cost-aware cleanup keeps expensive entries"
+
+    cat >compiler.sh <<EOF
+#!/bin/sh
+sleep \$SLEEP
+exec $COMPILER "\$@"
+EOF
+    chmod +x compiler.sh
+    echo 'int cheap;' >cheap.c
+    echo 'int expensive;' >expensive.c
+    # Without direct mode, only a result entry is stored in each cache.
+    SLEEP=0.1 CCACHE_NODIRECT=1 CCACHE_DIR=$PWD/cheap \
+        $CCACHE ./compiler.sh -c cheap.c
+    mv $(find cheap -mindepth 3 -type f ! -name stats) $CCACHE_DIR/0/0/cheapR
+    SLEEP=1 CCACHE_NODIRECT=1 CCACHE_DIR=$PWD/expensive \
+        $CCACHE ./compiler.sh -c expensive.c
+    mv $(find expensive -mindepth 3 -type f ! -name stats) \
+        $CCACHE_DIR/0/0/expensiveR
+    backdate $CCACHE_DIR/0/0/cheapR $CCACHE_DIR/0/0/expensiveR
+    $CCACHE -c >/dev/null
+    expect_stat files_in_cache 2562
+
+    # 10 files are kept in each directory, so 2 of the 12 files in 0/0 are
+    # removed. All files are equally old, so the cheap entry is removed first.
+    CCACHE_EVICTION_POLICY=cost $CCACHE -F 2560 -c >/dev/null
+    expect_exists $CCACHE_DIR/0/0/expensiveR
+    expect_missing $CCACHE_DIR/0/0/cheapR
+    expect_stat files_in_cache 2560
+
+    # -------------------------------------------------------------------------
+    TEST "Cold tier"
+
+    export CCACHE_COLDDIR=$PWD/cold
+
+    # Size-based cleanup moves entries to the cold tier.
+    $CCACHE -F 2543 -c >/dev/null
+    expect_file_count 2543 '*R' $CCACHE_DIR
+    expect_file_count 17 '*R' cold
+    expect_stat files_in_cache 2543
+
+    # A miss in the cache directory promotes the entry and its raw files from
+    # the cold tier.
+    $CCACHE -C >/dev/null
+    rm -rf cold
+    echo 'int x;' >test.c
+    CCACHE_HARDLINK=1 $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    expect_file_count 1 '*_00' $CCACHE_DIR
+
+    $CCACHE -M 1KiB -c >/dev/null
+    expect_stat files_in_cache 0
+    expect_file_count 0 '*_00' $CCACHE_DIR
+    expect_file_count 1 '*_00' cold
+
+    # Read-only mode doesn't promote entries.
+    rm test.o
+    CCACHE_READONLY=1 CCACHE_HARDLINK=1 $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 2
+    expect_stat files_in_cache 0
+    expect_file_count 1 '*_00' cold
+
+    rm test.o
+    CCACHE_HARDLINK=1 $CCACHE_COMPILE -c test.c
+    expect_stat preprocessed_cache_hit 1
+    expect_stat cache_miss 2
+    expect_exists test.o
+    expect_file_count 1 '*_00' $CCACHE_DIR
+    expect_file_count 0 '*' cold
+
+    # Explicit eviction deletes entries instead of demoting them.
+    $CCACHE --evict-older-than 0s >/dev/null
+    expect_stat files_in_cache 0
+    expect_file_count 0 '*' cold
 }
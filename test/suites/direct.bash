@@ -532,6 +532,45 @@ fi
     expect_stat preprocessed_cache_hit 0
     expect_stat cache_miss 5
 
+    # -------------------------------------------------------------------------
+    TEST "Concurrent manifest updates are merged"
+
+    # The compiler stores another result in the manifest by running ccache with
+    # a different test1.h while the first compilation is running.
+    cat >compiler.sh <<EOF
+#!/bin/sh
+case " \$* " in
+    *" -E "*) ;;
+    *)
+        if [ ! -f inner_done ]; then
+            touch inner_done
+            cp -p test1.h test1_orig.h
+            cp -p test1_other.h test1.h
+            (unset CCACHE_DISABLE; $CCACHE ./compiler.sh -c test.c)
+            cp -p test1_orig.h test1.h
+        fi
+        ;;
+esac
+exec $COMPILER "\$@"
+EOF
+    chmod +x compiler.sh
+    backdate compiler.sh
+    echo "int test1_other;" >test1_other.h
+    backdate test1_other.h
+
+    $CCACHE ./compiler.sh -c test.c
+    expect_stat direct_cache_hit 0
+    expect_stat cache_miss 2
+
+    $CCACHE ./compiler.sh -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 2
+
+    cp -p test1_other.h test1.h
+    $CCACHE ./compiler.sh -c test.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 2
+
     # -------------------------------------------------------------------------
     TEST "-MD"
 
@@ -35,7 +35,7 @@ expect_inode_cache_type() {
     local source_file=$2
     local type=$3
 
-    local actual=$(grep -c "Inode cache $type: $source_file" ${source_file/%.c/.o}.*.ccache-log)
+    local actual=$(grep -c "Inode cache $type: $source_file" ${source_file%.*}.o.*.ccache-log)
     if [ $actual -ne $expected ]; then
         test_failed_internal "Found $actual (expected $expected) $type for $source_file"
     fi
@@ -98,6 +98,20 @@ inode_cache_tests() {
     expect_inode_cache 0 1 1 test1.c
     expect_inode_cache 1 0 0 test2.c
 
+    # -------------------------------------------------------------------------
+    TEST "Preprocessed input without direct mode"
+
+    echo "int x;" > test1.c
+    $COMPILER -E test1.c > test1.i
+    CCACHE_NODIRECT=1 $CCACHE_COMPILE -c test1.i
+    expect_stat preprocessed_cache_miss 1
+    expect_inode_cache 0 1 1 test1.i
+    rm *.ccache-*
+
+    CCACHE_NODIRECT=1 $CCACHE_COMPILE -c test1.i
+    expect_stat preprocessed_cache_hit 1
+    expect_inode_cache 1 0 0 test1.i
+
     # -------------------------------------------------------------------------
     TEST "Replace"
 
@@ -486,6 +486,76 @@ SUITE_remote_file() {
     expect_stat remote_storage_read_miss 0
     expect_stat remote_storage_write 4
 
+    # -------------------------------------------------------------------------
+    TEST "Result prefetch"
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+
+    $CCACHE -C >/dev/null
+    CCACHE_DEBUG=1 $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat cache_miss 1
+    expect_stat remote_storage_hit 1
+    expect_stat remote_storage_read_hit 2 # result + manifest
+    expect_stat remote_storage_read_miss 2 # result + manifest
+    expect_stat files_in_cache 2
+    expect_contains test.o.*.ccache-log "Prefetching"
+    expect_not_contains test.o.*.ccache-log "Discarded prefetched"
+    rm test.o.*.ccache-log
+
+    # The result is already in local storage, so no prefetch.
+    CCACHE_DEBUG=1 $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 2
+    expect_stat remote_storage_read_hit 2
+    expect_not_contains test.o.*.ccache-log "Prefetching"
+    rm test.o.*.ccache-log
+
+    # The prefetched result does not match the changed include file.
+    $CCACHE -C >/dev/null
+    echo 'int x;' >test.h
+    backdate test.h
+    CCACHE_DEBUG=1 $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 2
+    expect_stat cache_miss 2
+    expect_contains test.o.*.ccache-log "Prefetching"
+    expect_contains test.o.*.ccache-log "Discarded prefetched"
+
+    # -------------------------------------------------------------------------
+    TEST "--prefetch"
+
+    CCACHE_LOGFILE=ccache.log $CCACHE_COMPILE -c test.c
+    expect_stat cache_miss 1
+    expect_stat files_in_cache 2
+
+    $CCACHE -C >/dev/null
+    expect_stat files_in_cache 0
+
+    $CCACHE --prefetch ccache.log >prefetch.out
+    expect_contains prefetch.out "Fetched 2 of 2 cache entries"
+    expect_stat remote_storage_read_hit 2
+    expect_stat files_in_cache 2
+
+    $CCACHE --prefetch ccache.log >prefetch.out
+    expect_contains prefetch.out "Fetched 0 of 2 cache entries"
+    expect_stat remote_storage_read_hit 2
+
+    $CCACHE_COMPILE -c test.c
+    expect_stat direct_cache_hit 1
+    expect_stat local_storage_hit 1
+    expect_stat remote_storage_read_hit 2
+
+    # Corrupt remote entries are not stored locally.
+    $CCACHE -C >/dev/null
+    for f in $(find remote -type f ! -name CACHEDIR.TAG); do
+        echo garbage >>$f
+    done
+    $CCACHE --prefetch ccache.log >prefetch.out
+    expect_contains prefetch.out "Fetched 0 of 2 cache entries"
+    expect_stat remote_storage_read_hit 2
+    expect_stat remote_storage_error 2
+    expect_stat files_in_cache 0
+
     # -------------------------------------------------------------------------
     if touch test.c && ln test.c test-if-fs-supports-hard-links.c 2>/dev/null; then
         TEST "Don't reshare results with raw files"
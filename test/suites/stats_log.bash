@@ -22,7 +22,11 @@ SUITE_stats_log() {
     expect_stat local_storage_read_hit 2
     expect_stat local_storage_read_miss 2
 
-    expect_content stats.log "# test.c
+    # Amounts like compile times vary between runs, so only check that the
+    # compile time is logged for the miss.
+    expect_contains stats.log "compile_time_millisecond "
+    grep -Ev '^[a-z_]+ [0-9]+$' stats.log >stats_ids.log
+    expect_content stats_ids.log "# test.c
 cache_miss
 direct_cache_miss
 local_storage_miss
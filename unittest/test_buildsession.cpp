@@ -0,0 +1,148 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "testutil.hpp"
+
+#include <ccache/buildsession.hpp>
+#include <ccache/config.hpp>
+#include <ccache/hash.hpp>
+#include <ccache/inodecache.hpp>
+#include <ccache/util/direntry.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/filesystem.hpp>
+#include <ccache/util/temporaryfile.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+
+namespace fs = util::filesystem;
+
+using namespace std::chrono_literals;
+
+using TestUtil::TestContext;
+
+namespace {
+
+bool
+build_session_available()
+{
+  auto tmp_file =
+    util::TemporaryFile::create((*fs::current_path()) / "fs_test");
+  if (!tmp_file) {
+    return false;
+  }
+  bool available = tmp_file->fd && InodeCache::available(*tmp_file->fd);
+  std::ignore = fs::remove(tmp_file->path);
+  return available;
+}
+
+void
+init(Config& config)
+{
+  config.set_debug(true);
+  config.set_temporary_dir(*fs::current_path());
+}
+
+const auto k_type = InodeCache::ContentType::checked_for_temporal_macros;
+
+} // namespace
+
+TEST_SUITE_BEGIN("BuildSession" * doctest::skip(!build_session_available()));
+
+TEST_CASE("No active session")
+{
+  TestContext test_context;
+
+  Config config;
+  init(config);
+  REQUIRE(util::write_file("a", "a text"));
+
+  BuildSession session(config, 0ns);
+  CHECK(!session.put(
+    "a", k_type, Hash().hash("a text").digest(), SourceCodeScanResult()));
+  CHECK(!session.get("a", k_type));
+  CHECK(BuildSession::end(config) == false);
+}
+
+TEST_CASE("Begin and end")
+{
+  TestContext test_context;
+
+  Config config;
+  init(config);
+
+  REQUIRE(BuildSession::begin(config));
+  CHECK(util::DirEntry(BuildSession::get_path(config)).is_regular_file());
+  REQUIRE(BuildSession::begin(config)); // Already active.
+  CHECK(BuildSession::end(config) == true);
+  CHECK(!util::DirEntry(BuildSession::get_path(config)).exists());
+}
+
+TEST_CASE("Share between instances")
+{
+  TestContext test_context;
+
+  Config config;
+  init(config);
+  REQUIRE(BuildSession::begin(config));
+  REQUIRE(util::write_file("a", "a text"));
+
+  BuildSession session_1(config, 0ns);
+  BuildSession session_2(config, 0ns);
+  CHECK(!session_2.get("a", k_type));
+
+  CHECK(session_1.put("a",
+                      k_type,
+                      Hash().hash("a text").digest(),
+                      SourceCodeScanResult(SourceCodeScan::found_date)));
+
+  auto result = session_2.get("a", k_type);
+  REQUIRE(result);
+  CHECK(result->first.to_bitmask()
+        == static_cast<int>(SourceCodeScan::found_date));
+  CHECK(result->second == Hash().hash("a text").digest());
+  CHECK(!session_2.get("a", InodeCache::ContentType::raw));
+
+  SUBCASE("Changed file is not matched")
+  {
+    REQUIRE(util::write_file("a", "something else"));
+    CHECK(!session_2.get("a", k_type));
+
+    CHECK(session_2.put("a",
+                        k_type,
+                        Hash().hash("something else").digest(),
+                        SourceCodeScanResult()));
+    result = session_1.get("a", k_type);
+    REQUIRE(result);
+    CHECK(result->second == Hash().hash("something else").digest());
+  }
+
+  SUBCASE("Too new file is not added")
+  {
+    REQUIRE(util::write_file("b", "b text"));
+    BuildSession session_3(config, 1h);
+    CHECK(!session_3.put(
+      "b", k_type, Hash().hash("b text").digest(), SourceCodeScanResult()));
+    CHECK(!session_1.get("b", k_type));
+  }
+
+  CHECK(BuildSession::end(config) == true);
+}
+
+TEST_SUITE_END();
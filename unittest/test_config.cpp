@@ -55,6 +55,7 @@ TEST_CASE("Config: default values")
   CHECK(!config.depend_mode());
   CHECK(config.direct_mode());
   CHECK(!config.disable());
+  CHECK(config.eviction_policy() == EvictionPolicy::lru);
   CHECK(config.extra_files_to_hash().empty());
   CHECK(!config.file_clone());
   CHECK(!config.hard_link());
@@ -80,9 +81,12 @@ TEST_CASE("Config: default values")
   CHECK_FALSE(config.read_only());
   CHECK_FALSE(config.read_only_direct());
   CHECK_FALSE(config.recache());
+  CHECK(config.remote_fill_max_size() == 1024 * 1024);
+  CHECK(config.remote_fill_policy() == RemoteFillPolicy::always);
   CHECK_FALSE(config.remote_only());
   CHECK(config.remote_storage().empty());
   CHECK_FALSE(config.reshare());
+  CHECK_FALSE(config.skip_unchanged_outputs());
   CHECK(config.sloppiness().to_bitmask() == 0);
   CHECK(config.stats());
   CHECK(config.temporary_dir().empty()); // Set later
@@ -257,6 +261,20 @@ TEST_CASE("Config::update_from_file, error handling")
     // Other cases tested in test_Util.c.
   }
 
+  SUBCASE("unknown eviction policy")
+  {
+    REQUIRE(util::write_file("ccache.conf", "eviction_policy = foo"));
+    REQUIRE_THROWS_WITH(config.update_from_file("ccache.conf"),
+                        "ccache.conf:1: unknown eviction policy: \"foo\"");
+  }
+
+  SUBCASE("unknown remote fill policy")
+  {
+    REQUIRE(util::write_file("ccache.conf", "remote_fill_policy = foo"));
+    REQUIRE_THROWS_WITH(config.update_from_file("ccache.conf"),
+                        "ccache.conf:1: unknown remote fill policy: \"foo\"");
+  }
+
   SUBCASE("unknown sloppiness")
   {
     REQUIRE(util::write_file("ccache.conf", "sloppiness = time_macros, foo"));
@@ -422,6 +440,21 @@ TEST_CASE("Config::update_from_environment")
   util::setenv("CCACHE_NOCOMPRESS", "1");
   config.update_from_environment();
   CHECK(!config.compression());
+
+  util::unsetenv("CCACHE_NOCOMPRESS");
+
+  util::setenv("CCACHE_COMPRESSLEVEL", "adaptive");
+  config.update_from_environment();
+  CHECK(config.compression_level_adaptive());
+  CHECK(config.compression_level() == 0);
+  CHECK(config.get_string_value("compression_level") == "adaptive");
+
+  util::setenv("CCACHE_COMPRESSLEVEL", "3");
+  config.update_from_environment();
+  CHECK(!config.compression_level_adaptive());
+  CHECK(config.compression_level() == 3);
+
+  util::unsetenv("CCACHE_COMPRESSLEVEL");
 }
 
 TEST_CASE("Config::response_file_format")
@@ -598,6 +631,7 @@ TEST_CASE("Config::visit_items")
     "ceiling_dirs = " ROOT_DIR
     "cedi\n"
     "ceiling_markers = cm\n"
+    "cold_cache_dir = ccd\n"
     "compiler = c\n"
     "compiler_check = cc\n"
     "compiler_type = clang\n"
@@ -609,6 +643,7 @@ TEST_CASE("Config::visit_items")
     "depend_mode = true\n"
     "direct_mode = false\n"
     "disable = true\n"
+    "eviction_policy = cost\n"
     "extra_files_to_hash = efth\n"
     "file_clone = true\n"
     "hard_link = true\n"
@@ -631,12 +666,15 @@ TEST_CASE("Config::visit_items")
     "read_only = true\n"
     "read_only_direct = true\n"
     "recache = true\n"
+    "remote_fill_max_size = 2M\n"
+    "remote_fill_policy = frequency\n"
     "remote_only = true\n"
     "remote_storage = rs\n"
     "reshare = true\n"
     "response_file_format = posix\n"
     "safe_dirs = " ROOT_DIR
     "sd\n"
+    "skip_unchanged_outputs = true\n"
     "sloppiness = include_file_mtime, include_file_ctime, time_macros,"
     " file_stat_matches, file_stat_matches_ctime, pch_defines, system_headers,"
     " clang_index_store, ivfsoverlay, gcno_cwd \n"
@@ -661,6 +699,7 @@ TEST_CASE("Config::visit_items")
     "(test.conf) cache_dir = cd",
     "(test.conf) ceiling_dirs = " ROOT_DIR "cedi",
     "(test.conf) ceiling_markers = cm",
+    "(test.conf) cold_cache_dir = ccd",
     "(test.conf) compiler = c",
     "(test.conf) compiler_check = cc",
     "(test.conf) compiler_type = clang",
@@ -672,6 +711,7 @@ TEST_CASE("Config::visit_items")
     "(test.conf) depend_mode = true",
     "(test.conf) direct_mode = false",
     "(test.conf) disable = true",
+    "(test.conf) eviction_policy = cost",
     "(test.conf) extra_files_to_hash = efth",
     "(test.conf) file_clone = true",
     "(test.conf) hard_link = true",
@@ -694,11 +734,14 @@ TEST_CASE("Config::visit_items")
     "(test.conf) read_only = true",
     "(test.conf) read_only_direct = true",
     "(test.conf) recache = true",
+    "(test.conf) remote_fill_max_size = 2.0 MB",
+    "(test.conf) remote_fill_policy = frequency",
     "(test.conf) remote_only = true",
     "(test.conf) remote_storage = rs",
     "(test.conf) reshare = true",
     "(test.conf) response_file_format = posix",
     "(test.conf) safe_dirs = " ROOT_DIR "sd",
+    "(test.conf) skip_unchanged_outputs = true",
     "(test.conf) sloppiness = clang_index_store, file_stat_matches,"
     " file_stat_matches_ctime, gcno_cwd, include_file_ctime,"
     " include_file_mtime, ivfsoverlay, pch_defines, system_headers,"
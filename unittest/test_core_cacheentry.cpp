@@ -0,0 +1,143 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <ccache/config.hpp>
+#include <ccache/core/cacheentry.hpp>
+#include <ccache/core/result.hpp>
+#include <ccache/util/bytes.hpp>
+#include <ccache/util/zstd.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+
+using core::CacheEntry;
+using core::CacheEntryType;
+using core::result::FileType;
+
+namespace {
+
+std::span<const uint8_t>
+compressed_payload(const util::Bytes& entry)
+{
+  const CacheEntry::Header header(entry);
+  return std::span<const uint8_t>(entry).subspan(
+    header.serialized_size(),
+    entry.size() - header.serialized_size() - 16); // 16: checksum size
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("core::CacheEntry");
+
+TEST_CASE("Result payload is compressed per file")
+{
+  Config config;
+  const CacheEntry::Header header(config, CacheEntryType::result);
+  REQUIRE(header.compression_type == core::CompressionType::zstd);
+
+  SUBCASE("Several files")
+  {
+    // Large enough to be decompressed in parallel if there are several cores.
+    const util::Bytes object(std::string(1024 * 1024, 'o'));
+    const util::Bytes dwo(std::string(768 * 1024, 'd'));
+    const util::Bytes stderr_output(std::string("warning"));
+
+    core::result::Serializer serializer(config);
+    serializer.add_data(FileType::object, object);
+    serializer.add_data(FileType::stderr_output, stderr_output);
+    serializer.add_data(FileType::dwarf_object, dwo);
+    util::Bytes payload;
+    serializer.serialize(payload);
+
+    const auto parts = core::result::split_file_entries(payload);
+    REQUIRE(parts.size() == 3);
+    CHECK(parts[0].size() == 2 + 10 + object.size());
+    CHECK(parts[1].size() == 10 + stderr_output.size());
+    CHECK(parts[2].size() == 10 + dwo.size());
+
+    const auto entry = CacheEntry::serialize(header, payload);
+    const auto compressed = compressed_payload(entry);
+    CHECK(util::zstd_read_skippable_frame(compressed, 0xc));
+
+    const CacheEntry cache_entry(entry);
+    cache_entry.verify_checksum();
+    CHECK(util::Bytes(cache_entry.payload()) == payload);
+
+    // The payload is still a valid Zstandard stream.
+    util::Bytes decompressed;
+    REQUIRE(util::zstd_decompress(compressed, decompressed, payload.size()));
+    CHECK(decompressed == payload);
+  }
+
+  SUBCASE("Several small files")
+  {
+    const util::Bytes object(std::string(1024 * 1024, 'o'));
+    const util::Bytes stderr_output(std::string("warning"));
+    core::result::Serializer serializer(config);
+    serializer.add_data(FileType::object, object);
+    serializer.add_data(FileType::stderr_output, stderr_output);
+    util::Bytes payload;
+    serializer.serialize(payload);
+
+    // Only one file is large enough to be decompressed in parallel.
+    CHECK(core::result::split_file_entries(payload).size() == 2);
+    const auto entry = CacheEntry::serialize(header, payload);
+    CHECK(!util::zstd_read_skippable_frame(compressed_payload(entry), 0xc));
+    CHECK(util::Bytes(CacheEntry(entry).payload()) == payload);
+  }
+
+  SUBCASE("One file")
+  {
+    const util::Bytes object(std::string("object"));
+    core::result::Serializer serializer(config);
+    serializer.add_data(FileType::object, object);
+    util::Bytes payload;
+    serializer.serialize(payload);
+
+    CHECK(core::result::split_file_entries(payload).size() == 1);
+    const auto entry = CacheEntry::serialize(header, payload);
+    CHECK(!util::zstd_read_skippable_frame(compressed_payload(entry), 0xc));
+    CHECK(util::Bytes(CacheEntry(entry).payload()) == payload);
+  }
+}
+
+TEST_CASE("Corrupt frame table is ignored")
+{
+  Config config;
+  const CacheEntry::Header header(config, CacheEntryType::result);
+
+  const util::Bytes object(std::string(1024 * 1024, 'o'));
+  const util::Bytes dwo(std::string(768 * 1024, 'd'));
+  core::result::Serializer serializer(config);
+  serializer.add_data(FileType::object, object);
+  serializer.add_data(FileType::dwarf_object, dwo);
+  util::Bytes payload;
+  serializer.serialize(payload);
+
+  auto entry = CacheEntry::serialize(header, payload);
+  REQUIRE(util::zstd_read_skippable_frame(compressed_payload(entry), 0xc));
+  // Make the first frame size in the table too large.
+  const size_t table_offset =
+    header.serialized_size() + util::k_zstd_skippable_frame_header_size;
+  entry[table_offset + 2] = 0xff;
+
+  CHECK(util::Bytes(CacheEntry(entry).payload()) == payload);
+}
+
+TEST_SUITE_END();
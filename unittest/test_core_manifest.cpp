@@ -0,0 +1,177 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <ccache/core/exceptions.hpp>
+#include <ccache/core/manifest.hpp>
+#include <ccache/hash.hpp>
+#include <ccache/util/bytes.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <unordered_map>
+
+using core::Manifest;
+
+namespace {
+
+Hash::Digest
+digest_of(std::string_view data)
+{
+  return Hash().hash(data).digest();
+}
+
+Manifest::FileStats
+stat_file(const std::string& path)
+{
+  return {path.length(), util::TimePoint(), util::TimePoint()};
+}
+
+util::Bytes
+serialize(Manifest& manifest)
+{
+  util::Bytes data;
+  manifest.serialize(data);
+  CHECK(data.size() == manifest.serialized_size());
+  return data;
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("core::Manifest");
+
+TEST_CASE("Empty manifest")
+{
+  Manifest manifest;
+  CHECK(!manifest.newest_result_digest());
+
+  const auto data = serialize(manifest);
+  Manifest read_manifest;
+  read_manifest.read(data);
+  CHECK(!read_manifest.newest_result_digest());
+  CHECK(serialize(read_manifest) == data);
+}
+
+TEST_CASE("Add results and read back")
+{
+  const std::unordered_map<std::string, Hash::Digest> files_1{
+    {"a.h", digest_of("a1")},
+    {"b.h", digest_of("b1")},
+  };
+  const std::unordered_map<std::string, Hash::Digest> files_2{
+    {"a.h", digest_of("a1")},
+    {"b.h", digest_of("b2")},
+    {"c.h", digest_of("c1")},
+  };
+
+  Manifest manifest;
+  CHECK(manifest.add_result(digest_of("r1"), files_1, stat_file));
+  CHECK(manifest.add_result(digest_of("r2"), files_2, stat_file));
+  CHECK(manifest.newest_result_digest() == digest_of("r2"));
+
+  SUBCASE("Duplicate result is not added")
+  {
+    const auto size = manifest.serialized_size();
+    CHECK(!manifest.add_result(digest_of("r1"), files_1, stat_file));
+    CHECK(manifest.serialized_size() == size);
+  }
+
+  SUBCASE("Paths and file infos are shared between results")
+  {
+    Manifest single;
+    CHECK(single.add_result(digest_of("r2"), files_2, stat_file));
+
+    // Only the file info for b.h, the result entry and its two indexes are
+    // unique to r1.
+    CHECK(manifest.serialized_size() - single.serialized_size()
+          == 48 + (8 + 20) + 2 * 4);
+  }
+
+  SUBCASE("Roundtrip")
+  {
+    const auto data = serialize(manifest);
+    Manifest read_manifest;
+    read_manifest.read(data);
+    CHECK(read_manifest.newest_result_digest() == digest_of("r2"));
+    CHECK(serialize(read_manifest) == data);
+    CHECK(!read_manifest.add_result(digest_of("r2"), files_2, stat_file));
+  }
+
+  SUBCASE("Merge into non-empty manifest")
+  {
+    Manifest other;
+    CHECK(other.add_result(digest_of("r3"), files_1, stat_file));
+    other.read(serialize(manifest));
+    CHECK(other.newest_result_digest() == digest_of("r2"));
+
+    // Everything but the r3 result entry and its indexes is shared.
+    CHECK(other.serialized_size()
+          == manifest.serialized_size() + (8 + 20) + 2 * 4);
+  }
+}
+
+TEST_CASE("Merge manifest into itself")
+{
+  std::unordered_map<std::string, Hash::Digest> files;
+  for (const auto* path : {"a.h", "b.h", "c.h", "d.h", "e.h"}) {
+    files.emplace(path, digest_of(path));
+  }
+
+  Manifest manifest;
+  CHECK(manifest.add_result(digest_of("r1"), files, stat_file));
+  files["a.h"] = digest_of("a2");
+  CHECK(manifest.add_result(digest_of("r2"), files, stat_file));
+  CHECK(manifest.result_count() == 2);
+
+  // Reading rebuilds the included files of each result, possibly in another
+  // order, but the results are still duplicates.
+  const auto data = serialize(manifest);
+  manifest.read(data);
+  CHECK(manifest.result_count() == 2);
+  CHECK(serialize(manifest) == data);
+}
+
+TEST_CASE("Corrupt manifest")
+{
+  Manifest manifest;
+  CHECK(manifest.add_result(
+    digest_of("r1"), {{"a.h", digest_of("a1")}}, stat_file));
+  auto data = serialize(manifest);
+
+  SUBCASE("Truncated")
+  {
+    data.resize(data.size() - 1);
+  }
+
+  SUBCASE("Bad format version")
+  {
+    data[0] = 0;
+  }
+
+  SUBCASE("Bad path index")
+  {
+    // First byte of the file info's path index, which follows the header and
+    // the single path end.
+    data[21 + 4] = 1;
+  }
+
+  Manifest read_manifest;
+  CHECK_THROWS_AS(read_manifest.read(data), core::Error);
+}
+
+TEST_SUITE_END();
@@ -40,6 +40,21 @@ TEST_CASE("read")
   CHECK(counters.get(Statistic::cache_miss) == 0);
 }
 
+TEST_CASE("read amounts")
+{
+  TestContext test_context;
+
+  REQUIRE(util::write_file("stats.log",
+                           "cache_miss\n"
+                           "compile_time_millisecond 1200\n"
+                           "compile_time_millisecond 34\n"
+                           "cache_miss x\n"));
+  const auto counters = StatsLog("stats.log").read();
+
+  CHECK(counters.get(Statistic::cache_miss) == 1);
+  CHECK(counters.get(Statistic::compile_time_millisecond) == 1234);
+}
+
 TEST_CASE("log_result")
 {
   TestContext test_context;
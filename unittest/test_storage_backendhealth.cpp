@@ -0,0 +1,113 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "testutil.hpp"
+
+#include <ccache/storage/backendhealth.hpp>
+#include <ccache/util/filesystem.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+
+namespace fs = util::filesystem;
+
+using namespace std::chrono_literals;
+
+using storage::BackendHealth;
+using TestUtil::TestContext;
+
+TEST_SUITE_BEGIN("storage::BackendHealth");
+
+TEST_CASE("storage::BackendHealth::backoff")
+{
+  CHECK(BackendHealth::backoff(0) == 0s);
+  CHECK(BackendHealth::backoff(1) == 1s);
+  CHECK(BackendHealth::backoff(2) == 2s);
+  CHECK(BackendHealth::backoff(3) == 4s);
+  CHECK(BackendHealth::backoff(7) == 60s);
+  CHECK(BackendHealth::backoff(1000) == 60s);
+}
+
+TEST_CASE("Shared between instances")
+{
+  TestContext test_context;
+
+  const auto dir = *fs::current_path();
+  const util::TimePoint t0(100s);
+
+  BackendHealth health_1(dir, "http://a");
+  CHECK(health_1.failures() == 0);
+  CHECK(!health_1.should_skip(t0));
+  health_1.record_failure(t0);
+
+  // Another backend is not affected.
+  CHECK(!BackendHealth(dir, "http://b").should_skip(t0));
+
+  SUBCASE("Skipped during back-off period")
+  {
+    BackendHealth health_2(dir, "http://a");
+    CHECK(health_2.failures() == 1);
+    CHECK(health_2.should_skip(t0 + 500ms));
+    CHECK(health_2.retry_in(t0 + 500ms) == 500ms);
+  }
+
+  SUBCASE("Failures are counted from the current state")
+  {
+    BackendHealth health_2(dir, "http://a");
+    health_1.record_failure(t0);
+    health_2.record_failure(t0);
+    CHECK(BackendHealth(dir, "http://a").failures() == 3);
+  }
+
+  SUBCASE("Only one probe after back-off period")
+  {
+    BackendHealth health_2(dir, "http://a");
+    BackendHealth other(dir, "http://a");
+    CHECK(!health_2.should_skip(t0 + 2s));
+    CHECK(other.should_skip(t0 + 2s));
+    CHECK(BackendHealth(dir, "http://a").should_skip(t0 + 2s));
+
+    SUBCASE("Success doesn't reset newer failures")
+    {
+      other.record_failure(t0 + 2s);
+      health_2.record_success();
+      CHECK(BackendHealth(dir, "http://a").failures() == 2);
+    }
+
+    SUBCASE("Failed probe doubles the period")
+    {
+      health_2.record_failure(t0 + 2s);
+      BackendHealth health_3(dir, "http://a");
+      CHECK(health_3.failures() == 2);
+      CHECK(health_3.should_skip(t0 + 3s));
+      CHECK(!health_3.should_skip(t0 + 4s));
+    }
+
+    SUBCASE("Successful probe resets the state")
+    {
+      health_2.record_success();
+      BackendHealth health_3(dir, "http://a");
+      CHECK(health_3.failures() == 0);
+      CHECK(!health_3.should_skip(t0 + 2s));
+    }
+  }
+}
+
+TEST_SUITE_END();
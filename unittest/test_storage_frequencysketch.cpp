@@ -0,0 +1,69 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "testutil.hpp"
+
+#include <ccache/config.hpp>
+#include <ccache/hash.hpp>
+#include <ccache/storage/frequencysketch.hpp>
+#include <ccache/util/filesystem.hpp>
+
+#include <doctest/doctest.h>
+
+namespace fs = util::filesystem;
+
+using storage::FrequencySketch;
+using TestUtil::TestContext;
+
+TEST_SUITE_BEGIN("storage::FrequencySketch");
+
+TEST_CASE("Count accesses")
+{
+  TestContext test_context;
+
+  Config config;
+  config.set_temporary_dir(*fs::current_path());
+
+  FrequencySketch sketch_1(config);
+  const auto key = Hash().hash("a").digest();
+  const auto first = sketch_1.increment(key);
+  if (!first) {
+    // The file system does not support shared memory mapped files.
+    return;
+  }
+  CHECK(*first == 1);
+  CHECK(sketch_1.increment(key) == 2);
+
+  SUBCASE("Shared between instances")
+  {
+    FrequencySketch sketch_2(config);
+    CHECK(sketch_2.increment(key) == 3);
+    CHECK(sketch_2.increment(Hash().hash("b").digest()) == 1);
+  }
+
+  SUBCASE("Saturation")
+  {
+    for (int i = 0; i < 20; ++i) {
+      sketch_1.increment(key);
+    }
+    CHECK(sketch_1.increment(key) == 15);
+  }
+}
+
+TEST_SUITE_END();
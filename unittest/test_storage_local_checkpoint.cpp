@@ -0,0 +1,93 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "testutil.hpp"
+
+#include <ccache/storage/local/checkpoint.hpp>
+#include <ccache/util/direntry.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/format.hpp>
+#include <ccache/util/time.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+
+using storage::local::Checkpoint;
+using TestUtil::TestContext;
+
+TEST_SUITE_BEGIN("storage::local::Checkpoint");
+
+TEST_CASE("Resume from checkpoint")
+{
+  TestContext test_context;
+
+  {
+    Checkpoint checkpoint("cp", "op");
+    CHECK(checkpoint.resumed_dirs() == 0);
+    checkpoint.mark_done(0, 1);
+    checkpoint.mark_done(15, 15);
+  }
+
+  SUBCASE("Same operation")
+  {
+    Checkpoint checkpoint("cp", "op");
+    CHECK(checkpoint.resumed_dirs() == 2);
+    CHECK(checkpoint.is_done(0, 1));
+    CHECK(checkpoint.is_done(15, 15));
+    CHECK(!checkpoint.is_done(0, 0));
+
+    checkpoint.remove();
+    CHECK(!util::DirEntry("cp").exists());
+  }
+
+  SUBCASE("Other operation")
+  {
+    Checkpoint checkpoint("cp", "other op");
+    CHECK(checkpoint.resumed_dirs() == 0);
+    CHECK(!checkpoint.is_done(0, 1));
+  }
+
+  SUBCASE("Expired checkpoint")
+  {
+    REQUIRE(util::write_file(
+      "cp",
+      FMT("op\n{}\n01\n", util::sec(util::now()) - 2 * 24 * 60 * 60)));
+    CHECK(Checkpoint("cp", "op").resumed_dirs() == 0);
+    CHECK(Checkpoint("cp", "op", std::chrono::hours(72)).resumed_dirs() == 1);
+  }
+
+  SUBCASE("Checkpoint without creation time")
+  {
+    REQUIRE(util::write_file("cp", "op\n01\n"));
+    CHECK(Checkpoint("cp", "op").resumed_dirs() == 0);
+  }
+}
+
+TEST_CASE("Resumed checkpoint keeps its creation time")
+{
+  TestContext test_context;
+
+  const auto creation_time = util::sec(util::now()) - 60 * 60;
+  REQUIRE(util::write_file("cp", FMT("op\n{}\n01\n", creation_time)));
+  Checkpoint("cp", "op").mark_done(0, 2);
+  CHECK(*util::read_file<std::string>("cp")
+        == FMT("op\n{}\n01\n02\n", creation_time));
+}
+
+TEST_SUITE_END();
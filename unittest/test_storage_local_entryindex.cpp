@@ -0,0 +1,142 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "testutil.hpp"
+
+#include <ccache/config.hpp>
+#include <ccache/core/cacheentry.hpp>
+#include <ccache/storage/local/entryindex.hpp>
+#include <ccache/storage/local/util.hpp>
+#include <ccache/util/bytes.hpp>
+#include <ccache/util/direntry.hpp>
+#include <ccache/util/file.hpp>
+#include <ccache/util/filesystem.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <string>
+
+namespace fs = util::filesystem;
+
+using core::CacheEntry;
+using storage::local::EntryIndex;
+using TestUtil::TestContext;
+using util::DirEntry;
+
+namespace {
+
+CacheEntry::Header
+make_header(const std::string& namespace_)
+{
+  Config config;
+  CacheEntry::Header header(config, core::CacheEntryType::result);
+  header.namespace_ = namespace_;
+  return header;
+}
+
+void
+write_entry(const std::string& path, const std::string& namespace_)
+{
+  REQUIRE(util::write_file(
+    path, CacheEntry::serialize(make_header(namespace_), util::Bytes())));
+}
+
+// Replace the content of `path` without changing its size or modification
+// time.
+void
+overwrite_behind_index(const std::string& path)
+{
+  const DirEntry before(path);
+  REQUIRE(util::write_file(path, std::string(before.size(), 'x')));
+  util::set_timestamps(path, before.mtime());
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("storage::local::EntryIndex");
+
+TEST_CASE("Headers are indexed")
+{
+  TestContext test_context;
+
+  REQUIRE(fs::create_directory("d"));
+  write_entry("d/1", "ns");
+  REQUIRE(util::write_file("d/1_00", "raw file"));
+
+  const EntryIndex index("d");
+  auto files = storage::local::get_cache_dir_files("d");
+  REQUIRE(files.size() == 2);
+  std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+    return a.path() < b.path();
+  });
+
+  auto headers = index.get_headers(files);
+  REQUIRE(headers.size() == 2);
+  REQUIRE(headers[0]);
+  CHECK(headers[0]->namespace_ == "ns");
+  CHECK(!headers[1]);
+  CHECK(DirEntry(EntryIndex::get_path("d")).is_regular_file());
+
+  SUBCASE("Unchanged file is not read again")
+  {
+    overwrite_behind_index("d/1");
+    headers = index.get_headers({DirEntry("d/1")});
+    REQUIRE(headers[0]);
+    CHECK(headers[0]->namespace_ == "ns");
+  }
+
+  SUBCASE("Changed file is read again")
+  {
+    write_entry("d/1", "other");
+    headers = index.get_headers({DirEntry("d/1")});
+    REQUIRE(headers[0]);
+    CHECK(headers[0]->namespace_ == "other");
+  }
+
+  SUBCASE("Added entry")
+  {
+    write_entry("d/2", "added");
+    index.add(DirEntry("d/2"), make_header("added"));
+    overwrite_behind_index("d/2");
+
+    headers = index.get_headers({DirEntry("d/1"), DirEntry("d/2")});
+    REQUIRE(headers[1]);
+    CHECK(headers[1]->namespace_ == "added");
+  }
+
+  SUBCASE("Corrupt index")
+  {
+    REQUIRE(util::write_file(EntryIndex::get_path("d"), "garbage"));
+    headers = index.get_headers({DirEntry("d/1")});
+    REQUIRE(headers[0]);
+    CHECK(headers[0]->namespace_ == "ns");
+  }
+}
+
+TEST_CASE("Index is not created by add")
+{
+  TestContext test_context;
+
+  REQUIRE(fs::create_directory("d"));
+  write_entry("d/1", "");
+  EntryIndex("d").add(DirEntry("d/1"), make_header(""));
+  CHECK(!DirEntry(EntryIndex::get_path("d")).exists());
+}
+
+TEST_SUITE_END();
@@ -23,6 +23,7 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <stdexcept>
 #include <thread>
@@ -583,4 +584,161 @@ TEST_CASE("ThreadPool enqueue")
   }
 }
 
+TEST_CASE("ThreadPool batch submission")
+{
+  SUBCASE("all tasks in a batch execute")
+  {
+    util::ThreadPool pool(4);
+    std::atomic<int> counter{0};
+    const int num_tasks = 100;
+
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < num_tasks; ++i) {
+      tasks.emplace_back([&] { ++counter; });
+    }
+    pool.enqueue_detach(std::move(tasks));
+    pool.shut_down();
+
+    CHECK(counter == num_tasks);
+  }
+
+  SUBCASE("batch larger than maximum queue size")
+  {
+    util::ThreadPool pool(2, 3);
+    std::atomic<int> counter{0};
+    const int num_tasks = 20;
+
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < num_tasks; ++i) {
+      tasks.emplace_back([&] { ++counter; });
+    }
+    pool.enqueue_detach(std::move(tasks));
+    pool.shut_down();
+
+    CHECK(counter == num_tasks);
+  }
+
+  SUBCASE("batch executes in FIFO order on single thread")
+  {
+    util::ThreadPool pool(1);
+    std::vector<int> execution_order;
+
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < 10; ++i) {
+      tasks.emplace_back([&, i] { execution_order.push_back(i); });
+    }
+    pool.enqueue_detach(std::move(tasks));
+    pool.shut_down();
+
+    REQUIRE(execution_order.size() == 10);
+    for (int i = 0; i < 10; ++i) {
+      CHECK(execution_order[i] == i);
+    }
+  }
+}
+
+TEST_CASE("ThreadPool work stealing")
+{
+  SUBCASE("idle worker takes tasks queued for a busy worker")
+  {
+    util::ThreadPool pool(2);
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool can_finish = false;
+    std::atomic<int> counter{0};
+
+    // Tasks enqueued by a worker are put in its own queue, so they can only
+    // run if the other worker steals them while the first one is blocked.
+    auto blocking_future = pool.enqueue([&] {
+      for (int i = 0; i < 10; ++i) {
+        pool.enqueue_detach([&] {
+          if (++counter == 10) {
+            std::lock_guard<std::mutex> lock(mutex);
+            can_finish = true;
+            cv.notify_all();
+          }
+        });
+      }
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return can_finish; });
+    });
+
+    blocking_future.get();
+    pool.shut_down();
+    CHECK(counter == 10);
+  }
+}
+
+TEST_CASE("ThreadPool parallel_for")
+{
+  SUBCASE("visits each index once")
+  {
+    util::ThreadPool pool(4);
+    std::vector<std::atomic<int>> visits(1000);
+
+    pool.parallel_for(0, visits.size(), [&](size_t i) { ++visits[i]; });
+
+    for (const auto& count : visits) {
+      CHECK(count == 1);
+    }
+  }
+
+  SUBCASE("chunks and offset range")
+  {
+    util::ThreadPool pool(3);
+    std::atomic<size_t> sum{0};
+
+    pool.parallel_for(10, 110, [&](size_t i) { sum += i; }, 7);
+
+    CHECK(sum == (10 + 109) * 100 / 2);
+  }
+
+  SUBCASE("empty range")
+  {
+    util::ThreadPool pool(2);
+    bool called = false;
+
+    pool.parallel_for(5, 5, [&](size_t) { called = true; });
+
+    CHECK(!called);
+  }
+
+  SUBCASE("exception is rethrown")
+  {
+    util::ThreadPool pool(2);
+
+    CHECK_THROWS_AS(pool.parallel_for(0,
+                                      100,
+                                      [](size_t i) {
+                                        if (i == 42) {
+                                          throw std::runtime_error("42");
+                                        }
+                                      }),
+                    std::runtime_error);
+  }
+
+  SUBCASE("nested call from worker thread")
+  {
+    util::ThreadPool pool(2, 1);
+    std::atomic<int> counter{0};
+
+    pool.parallel_for(0, 4, [&](size_t) {
+      pool.parallel_for(0, 10, [&](size_t) { ++counter; });
+    });
+
+    CHECK(counter == 40);
+  }
+
+  SUBCASE("after shutdown the calling thread does all work")
+  {
+    util::ThreadPool pool(2);
+    pool.shut_down();
+    std::atomic<int> counter{0};
+
+    pool.parallel_for(0, 10, [&](size_t) { ++counter; });
+
+    CHECK(counter == 10);
+  }
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,46 @@
+// Copyright (C) 2026 Joel Rosdahl and other contributors
+//
+// See doc/authors.adoc for a complete list of contributors.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 51
+// Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <ccache/util/throttle.hpp>
+#include <ccache/util/timer.hpp>
+
+#include <doctest/doctest.h>
+
+TEST_SUITE_BEGIN("util");
+
+TEST_CASE("Throttle without limit")
+{
+  util::Throttle throttle(0);
+  util::Timer timer;
+  throttle.consume(1'000'000'000);
+  throttle.consume(1'000'000'000);
+  CHECK(timer.measure_s() < 0.5);
+}
+
+TEST_CASE("Throttle with limited rate")
+{
+  util::Throttle throttle(1000);
+  util::Timer timer;
+  throttle.consume(100); // Not delayed.
+  CHECK(timer.measure_s() < 0.05);
+  throttle.consume(100);
+  throttle.consume(100);
+  CHECK(timer.measure_s() >= 0.19);
+}
+
+TEST_SUITE_END();
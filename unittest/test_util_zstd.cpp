@@ -76,3 +76,72 @@ TEST_CASE("ZSTD roundtrip")
   CHECK(result);
   CHECK(decompressed_input == original_input);
 }
+
+TEST_CASE("util::zstd_decompress into span")
+{
+  TestContext test_context;
+
+  util::Bytes output(2);
+  CHECK(util::zstd_decompress(compressed_ab, std::span<uint8_t>(output)));
+  CHECK(output == util::Bytes{'a', 'b'});
+
+  util::Bytes too_large(3);
+  CHECK(!util::zstd_decompress(compressed_ab, std::span<uint8_t>(too_large)));
+}
+
+TEST_CASE("util::zstd_write_skippable_frame")
+{
+  TestContext test_context;
+
+  util::Bytes input;
+  util::zstd_write_skippable_frame(input, 0xc, util::Bytes{'x', 'y', 'z'});
+  CHECK(input.size() == util::k_zstd_skippable_frame_header_size + 3);
+  input.insert(input.end(), compressed_ab);
+
+  const auto content = util::zstd_read_skippable_frame(input, 0xc);
+  REQUIRE(content);
+  CHECK(util::Bytes(*content) == util::Bytes{'x', 'y', 'z'});
+  CHECK(!util::zstd_read_skippable_frame(input, 0xd));
+  CHECK(!util::zstd_read_skippable_frame(compressed_ab, 0xc));
+
+  // Decompressors skip the frame.
+  util::Bytes output;
+  CHECK(util::zstd_decompress(input, output, 2));
+  CHECK(output == util::Bytes{'a', 'b'});
+}
+
+TEST_CASE("util::zstd_adaptive_compression_level")
+{
+  const uint64_t mib = 1024 * 1024;
+  const double speed = 500e6;
+  const double ratio = 0.35;
+
+  SUBCASE("Small input")
+  {
+    CHECK(util::zstd_adaptive_compression_level(1000, speed, ratio, 1e6) == 1);
+    util::Bytes input;
+    input.resize(1000);
+    CHECK(util::zstd_adaptive_compression_level(input, 1e6) == 1);
+  }
+
+  SUBCASE("Fast storage")
+  {
+    CHECK(util::zstd_adaptive_compression_level(10 * mib, speed, ratio, 2e9)
+          == 1);
+  }
+
+  SUBCASE("Slow storage")
+  {
+    CHECK(util::zstd_adaptive_compression_level(10 * mib, speed, ratio, 5e6)
+          > 1);
+    CHECK(util::zstd_adaptive_compression_level(10 * mib, speed, ratio, 1e5)
+          > util::zstd_adaptive_compression_level(
+            10 * mib, speed, ratio, 5e6));
+  }
+
+  SUBCASE("Incompressible input")
+  {
+    CHECK(util::zstd_adaptive_compression_level(10 * mib, speed, 1.0, 1e5)
+          == 1);
+  }
+}